@@ -0,0 +1,164 @@
+/*****************************************************************************
+*
+* Cpp file Benchmark.cpp
+*	Micro and macro benchmarks: BigInt arithmetic across operand sizes,
+*	Solovay Strassen per bit width, range counting and Mersenne numbers
+*	Medians and percentiles on the console, JSON for regression checks
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*****************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "ProbablePrime.h"
+#include "PrimeSearch.h"
+#include "Benchmark.h"
+
+const DatType BENCH_ROUNDS = 25;		// Solovay-Strassen rounds, as NUMTEST
+const int BENCH_MACRO_REPS = 5;			// samples of the benchmarks of a second or more
+const DatType BENCH_RANGE = 1 << 20;		// numbers per range benchmark
+
+// Random operand of exactly bits bits
+BigInt BenchOperand( SizeType bits ) {
+	return ( BigInt( 1 ) << (DatType)( bits - 1 ) ) + RandBigIntBits( bits - 1 );
+}
+
+// Arithmetic of two operands of bits bits ( a dividend of twice the size for divmod )
+void AddArithmetic( BenchRunner &runner, SizeType bits ) {
+	std::string size = "/" + std::to_string( bits );
+	BigInt a = BenchOperand( bits ), b = BenchOperand( bits ), wide = BenchOperand( 2 * bits );
+	BigInt odd = b;
+	if ( odd % 2 == 0 ) odd += 1;
+
+	runner.Add( "BigInt/add" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( a + b );
+	} );
+	runner.Add( "BigInt/sub" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( a - b );
+	} );
+	runner.Add( "BigInt/mul" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( a * b );
+	} );
+	runner.Add( "BigInt/sqr" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( a * a );
+	} );
+	runner.Add( "BigInt/divmod" + size, [=]( DatType iters ) {
+		BigInt q, r;
+		for ( DatType i = 0; i < iters; i++ ) {
+			wide.DivMod( b, q, r );
+			KeepValue( r );
+		}
+	} );
+	// the quadratic algorithms stop at 16k bits
+	if ( bits > 16384 ) return;
+	runner.Add( "BigInt/jacobi" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( Jacobi<BigInt>( a, odd ) );
+	} );
+	runner.Add( "BigInt/gcd" + size, [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( Gcd<BigInt>( a, b ) );
+	} );
+}
+
+// Full Solovay-Strassen test ( prefilter and BENCH_ROUNDS rounds ) of a prime
+void AddSolovayStrassen( BenchRunner &runner, SizeType bits ) {
+	BigInt n = RandomPrime( bits );
+	runner.Add( "SolovayStrassen/" + std::to_string( bits ), [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( SolovayStrassen<BigInt>( n, BENCH_ROUNDS ) );
+	}, 0, ( bits >= 2048 )?BENCH_MACRO_REPS:0 );
+}
+
+// Primes in [lo, lo + BENCH_RANGE) like the range command, items are numbers
+void AddRange( BenchRunner &runner, const std::string &name, DatType lo, PrimeTestMode mode, ThreadPool *pool ) {
+	runner.Add( "Range/" + name, [=]( DatType iters ) {
+		std::vector<DatType> primes = SmallPrimes( SIEVE_PRIME_LIMIT );
+		DatType s = ( mode == MILLER_RABIN )?( BENCH_ROUNDS + 1 ) / 2:BENCH_ROUNDS;
+		DatType nseg = BENCH_RANGE / SIEVE_SEGMENT;
+		for ( DatType i = 0; i < iters; i++ ) {
+			std::atomic<DatType> num( 0 );
+			pool->ParallelFor( nseg, [&]( DatType k ) {
+				DatType slo = lo + k * SIEVE_SEGMENT;
+				num += CountSegmentPrimes( slo, slo + SIEVE_SEGMENT, primes, mode, s );
+			} );
+			KeepValue( num );
+		}
+	}, BENCH_RANGE, BENCH_MACRO_REPS );
+}
+
+// Solovay-Strassen ( rounds on the pool ) and Lucas-Lehmer on 2^p - 1
+void AddMersenne( BenchRunner &runner, DatType pw, ThreadPool *pool ) {
+	BigInt n = ( BigInt( 1 ) << pw ) - 1;
+	runner.Add( "Mersenne/ss/" + std::to_string( pw ), [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( SolovayStrassen<BigInt>( n, BENCH_ROUNDS, false, pool ) );
+	}, 0, BENCH_MACRO_REPS );
+	runner.Add( "Mersenne/ll/" + std::to_string( pw ), [=]( DatType iters ) {
+		for ( DatType i = 0; i < iters; i++ ) KeepValue( LucasLehmer( pw ) );
+	}, 0, BENCH_MACRO_REPS );
+}
+
+// Main function
+int main( int argc, char* argv[] ) {
+	BenchRunner runner;
+	std::string json, baseline;
+	double threshold = 0.05;
+	int nthreads = 0;
+	bool list = false;
+	for ( int i = 1; i < argc; i++ ) {
+		std::string opt = argv[i];
+		bool value = ( i + 1 < argc );
+		if ( opt == "--filter" && value ) runner.filter = argv[++i];
+		else if ( opt == "--json" && value ) json = argv[++i];
+		else if ( opt == "--compare" && value ) baseline = argv[++i];
+		else if ( opt == "--threshold" && value ) threshold = atof( argv[++i] );
+		else if ( opt == "--repetitions" && value ) runner.repetitions = atoi( argv[++i] );
+		else if ( opt == "--min-time" && value ) runner.minTime = atof( argv[++i] );
+		else if ( opt == "--threads" && value ) nthreads = atoi( argv[++i] );
+		else if ( opt == "--list" ) list = true;
+		else {
+			std::cout << "Usage: " << argv[0] << " [--filter <substring>] [--json <file>] [--compare <baseline.json>] [--threshold <fraction>] "
+				"[--repetitions <n>] [--min-time <seconds>] [--threads <n>] [--list]" << std::endl;
+			return 1;
+		}
+	}
+
+	// fixed operands and witnesses from run to run
+	SetRandomSeed( 1 );
+	ThreadPool pool( nthreads );
+	SizeType sizes[] = { 256, 1024, 4096, 16384, 65536 };
+	for ( size_t i = 0; i < sizeof( sizes ) / sizeof( sizes[0] ); i++ ) AddArithmetic( runner, sizes[i] );
+	SizeType widths[] = { 128, 256, 512, 1024, 2048 };
+	for ( size_t i = 0; i < sizeof( widths ) / sizeof( widths[0] ); i++ ) AddSolovayStrassen( runner, widths[i] );
+	AddRange( runner, "ss/1e6", 1000000, SOLOVAY_STRASSEN, &pool );
+	AddRange( runner, "ss/1e12", 1000000000000LL, SOLOVAY_STRASSEN, &pool );
+	AddRange( runner, "mr/1e12", 1000000000000LL, MILLER_RABIN, &pool );
+	AddRange( runner, "bpsw/1e12", 1000000000000LL, BPSW, &pool );
+	DatType exponents[] = { 521, 1279, 2203 };
+	for ( size_t i = 0; i < sizeof( exponents ) / sizeof( exponents[0] ); i++ ) AddMersenne( runner, exponents[i], &pool );
+
+	if ( list ) {
+		for ( size_t i = 0; i < runner.benches.size(); i++ ) std::cout << runner.benches[i].name << std::endl;
+		return 0;
+	}
+
+	std::vector<BenchResult> results = runner.RunAll();
+	if ( !json.empty() && !WriteBenchJson( json, results, pool.Size() ) ) {
+		std::cerr << "cannot write " << json << std::endl;
+		return 1;
+	}
+	if ( !baseline.empty() ) {
+		std::map<std::string, double> medians;
+		if ( !ReadBenchJson( baseline, medians ) ) {
+			std::cerr << "cannot read " << baseline << std::endl;
+			return 1;
+		}
+		int slower = CompareBench( results, medians, threshold );
+		if ( slower > 0 ) {
+			std::cout << slower << " benchmark(s) slower than " << baseline << " by more than " << 100 * threshold << "%" << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
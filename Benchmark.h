@@ -0,0 +1,245 @@
+/*************************************************************************
+*
+* Header file Benchmark.h
+*	a small benchmark runner on the Stopwatch: every benchmark
+*	is calibrated to a minimum sample time, warmed up, repeated, and
+*	reported by median and percentiles on the console and in JSON
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <time.h>
+
+#include "Limb.h"
+#include "Stopwatch.h"
+
+// Keep a result alive without printing it, so the timed work is not optimized away
+template <typename T>
+static inline void KeepValue( const T &v ) {
+	asm volatile( "" : : "r"( &v ) : "memory" );
+}
+
+// body( iters ) runs the measured operation iters times; items is the number
+// of items ( numbers, candidates ) one operation handles, 0 for none
+struct Benchmark {
+	std::string name;
+	std::function<void( DatType )> body;
+	double items;
+	int repetitions;		// 0: the runner default
+};
+
+struct BenchResult {
+	std::string name;
+	DatType iterations;		// per sample
+	std::vector<double> samples;	// ns per operation, sorted
+	double items;
+
+	double Percentile( double q ) const;
+	double Mean() const;
+	double Stddev() const;
+};
+
+// Linear interpolation between the closest ranks
+inline double BenchResult::Percentile( double q ) const {
+	if ( samples.empty() ) return 0;
+	double pos = q * ( samples.size() - 1 );
+	size_t k = (size_t)pos;
+	if ( k + 1 >= samples.size() ) return samples.back();
+	return samples[k] + ( pos - k ) * ( samples[k+1] - samples[k] );
+}
+
+inline double BenchResult::Mean() const {
+	double sum = 0;
+	for ( size_t i = 0; i < samples.size(); i++ ) sum += samples[i];
+	return samples.empty()?0:sum / samples.size();
+}
+
+inline double BenchResult::Stddev() const {
+	if ( samples.size() < 2 ) return 0;
+	double mean = Mean(), sum = 0;
+	for ( size_t i = 0; i < samples.size(); i++ ) sum += ( samples[i] - mean ) * ( samples[i] - mean );
+	return sqrt( sum / ( samples.size() - 1 ) );
+}
+
+struct BenchRunner {
+	std::vector<Benchmark> benches;
+	double minTime;			// seconds per sample
+	int repetitions;		// samples per benchmark, after one warmup sample
+	std::string filter;		// run only the names containing it
+
+	BenchRunner():minTime(0.05),repetitions(15) {};
+
+	void Add( const std::string &name, const std::function<void( DatType )> &body, double items = 0, int reps = 0 );
+	BenchResult Run( const Benchmark &b ) const;
+	std::vector<BenchResult> RunAll() const;
+};
+
+inline void BenchRunner::Add( const std::string &name, const std::function<void( DatType )> &body, double items, int reps ) {
+	Benchmark b;
+	b.name = name;
+	b.body = body;
+	b.items = items;
+	b.repetitions = reps;
+	benches.push_back( b );
+}
+
+// Double the iteration count until a sample takes minTime ( the calibration
+// runs also warm caches, the limb pool and the radix tables ), take one more
+// warmup sample, then the measured ones
+inline BenchResult BenchRunner::Run( const Benchmark &b ) const {
+	BenchResult r;
+	r.name = b.name;
+	r.items = b.items;
+	DatType iters = 1;
+	while ( true ) {
+		Stopwatch w;
+		b.body( iters );
+		double ns = w.Ns();
+		if ( ns >= minTime * 1e9 || iters >= ( (DatType)1 << 40 ) ) break;
+		// aim at the target directly once the time is measurable
+		DatType next = ( ns > 1e6 )?(DatType)( iters * minTime * 1.2e9 / ns ):2 * iters;
+		iters = std::max( next, iters + 1 );
+	}
+	b.body( iters );
+	int reps = ( b.repetitions > 0 )?b.repetitions:repetitions;
+	for ( int k = 0; k < reps; k++ ) {
+		Stopwatch w;
+		b.body( iters );
+		r.samples.push_back( w.Ns() / iters );
+	}
+	std::sort( r.samples.begin(), r.samples.end() );
+	r.iterations = iters;
+	return r;
+}
+
+// Nanoseconds with a unit that keeps 3 to 4 digits
+inline std::string FormatNs( double ns ) {
+	char buf[32];
+	if ( ns < 1e4 ) snprintf( buf, sizeof( buf ), "%.1f ns", ns );
+	else if ( ns < 1e7 ) snprintf( buf, sizeof( buf ), "%.1f us", ns / 1e3 );
+	else if ( ns < 1e10 ) snprintf( buf, sizeof( buf ), "%.1f ms", ns / 1e6 );
+	else snprintf( buf, sizeof( buf ), "%.2f s", ns / 1e9 );
+	return buf;
+}
+
+inline std::string FormatItems( double perSecond ) {
+	char buf[32];
+	if ( perSecond < 1e3 ) snprintf( buf, sizeof( buf ), "%.1f/s", perSecond );
+	else if ( perSecond < 1e6 ) snprintf( buf, sizeof( buf ), "%.1fk/s", perSecond / 1e3 );
+	else if ( perSecond < 1e9 ) snprintf( buf, sizeof( buf ), "%.1fM/s", perSecond / 1e6 );
+	else snprintf( buf, sizeof( buf ), "%.1fG/s", perSecond / 1e9 );
+	return buf;
+}
+
+inline void PrintBenchHeader() {
+	char buf[160];
+	snprintf( buf, sizeof( buf ), "%-36s %10s %12s %12s %12s %12s %7s", "Benchmark", "Iters", "Median", "P10", "P90", "P99", "CV" );
+	std::cout << buf << std::endl << std::string( 105, '-' ) << std::endl;
+}
+
+inline void PrintBenchResult( const BenchResult &r ) {
+	char buf[200];
+	double median = r.Percentile( 0.5 );
+	snprintf( buf, sizeof( buf ), "%-36s %10lld %12s %12s %12s %12s %6.1f%%", r.name.c_str(), (long long)r.iterations,
+		FormatNs( median ).c_str(), FormatNs( r.Percentile( 0.1 ) ).c_str(), FormatNs( r.Percentile( 0.9 ) ).c_str(),
+		FormatNs( r.Percentile( 0.99 ) ).c_str(), 100 * r.Stddev() / r.Mean() );
+	std::cout << buf;
+	if ( r.items > 0 ) std::cout << "  " << FormatItems( r.items * 1e9 / median );
+	std::cout << std::endl;
+}
+
+inline std::vector<BenchResult> BenchRunner::RunAll() const {
+	std::vector<BenchResult> results;
+	PrintBenchHeader();
+	for ( size_t i = 0; i < benches.size(); i++ ) {
+		if ( !filter.empty() && benches[i].name.find( filter ) == std::string::npos ) continue;
+		results.push_back( Run( benches[i] ) );
+		PrintBenchResult( results.back() );
+	}
+	return results;
+}
+
+// Build description for the JSON context
+inline std::string BenchBuild() {
+	std::string s = "limb" + std::to_string( LIMB_BITS );
+#ifdef BIGINT_STD_ALLOC
+	s += " std_alloc";
+#endif
+#ifdef __VERSION__
+	s += std::string( " " ) + __VERSION__;
+#endif
+	return s;
+}
+
+// One benchmark per line, so that ReadBenchJson needs no JSON parser
+inline bool WriteBenchJson( const std::string &path, const std::vector<BenchResult> &results, int threads ) {
+	std::ofstream out( path.c_str() );
+	if ( !out ) return false;
+	char date[32];
+	time_t now = time( NULL );
+	strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", localtime( &now ) );
+	out << "{" << std::endl;
+	out << "  \"context\": { \"date\": \"" << date << "\", \"threads\": " << threads << ", \"build\": \"" << BenchBuild() << "\" }," << std::endl;
+	out << "  \"benchmarks\": [" << std::endl;
+	char buf[512];
+	for ( size_t i = 0; i < results.size(); i++ ) {
+		const BenchResult &r = results[i];
+		double median = r.Percentile( 0.5 );
+		snprintf( buf, sizeof( buf ), "    { \"name\": \"%s\", \"iterations\": %lld, \"repetitions\": %d, \"median_ns\": %.3f, "
+			"\"p10_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, \"mean_ns\": %.3f, "
+			"\"stddev_ns\": %.3f, \"items_per_second\": %.3f }%s", r.name.c_str(), (long long)r.iterations, (int)r.samples.size(),
+			median, r.Percentile( 0.1 ), r.Percentile( 0.9 ), r.Percentile( 0.99 ), r.samples.front(), r.samples.back(),
+			r.Mean(), r.Stddev(), ( r.items > 0 )?r.items * 1e9 / median:0.0, ( i + 1 < results.size() )?",":"" );
+		out << buf << std::endl;
+	}
+	out << "  ]" << std::endl << "}" << std::endl;
+	return (bool)out;
+}
+
+// Median by name from a file written by WriteBenchJson
+inline bool ReadBenchJson( const std::string &path, std::map<std::string, double> &medians ) {
+	std::ifstream in( path.c_str() );
+	if ( !in ) return false;
+	std::string line;
+	while ( std::getline( in, line ) ) {
+		size_t n = line.find( "\"name\": \"" ), m = line.find( "\"median_ns\": " );
+		if ( n == std::string::npos || m == std::string::npos ) continue;
+		n += 9;
+		medians[line.substr( n, line.find( '"', n ) - n )] = atof( line.c_str() + m + 13 );
+	}
+	return true;
+}
+
+// Median ratios against a baseline, return the number of benchmarks slower by
+// more than threshold ( 0.05 = 5% )
+inline int CompareBench( const std::vector<BenchResult> &results, const std::map<std::string, double> &baseline, double threshold ) {
+	int slower = 0;
+	char buf[160];
+	std::cout << std::endl;
+	for ( size_t i = 0; i < results.size(); i++ ) {
+		std::map<std::string, double>::const_iterator it = baseline.find( results[i].name );
+		if ( it == baseline.end() || it->second <= 0 ) continue;
+		double ratio = results[i].Percentile( 0.5 ) / it->second;
+		bool slow = ratio > 1 + threshold;
+		slower += slow;
+		snprintf( buf, sizeof( buf ), "%-36s %12s -> %12s  %+6.1f%%%s", results[i].name.c_str(), FormatNs( it->second ).c_str(),
+			FormatNs( results[i].Percentile( 0.5 ) ).c_str(), 100 * ( ratio - 1 ), slow?"  SLOWER":"" );
+		std::cout << buf << std::endl;
+	}
+	return slower;
+}
+
+#endif
@@ -8,557 +8,850 @@
 *
 *************************************************************************/
 
+#ifndef BIGINT_H
+#define BIGINT_H
+
 #include <iostream>
-#include <sstream>
 #include <string>
-#include <random>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
 
-typedef long long int DatType;
-typedef long SizeType;
-std::mt19937_64 randomEngine((unsigned)time(NULL));
+#include "Limb.h"
+#include "LimbMul.h"
+#include "LimbPool.h"
+#include "Random.h"
 
 struct BigInt {
-	std::string digits;
-	SizeType size;		// number of used digits
+	LimbVector limbs;	// magnitude, least significant limb first
+	SizeType size;		// number of used limbs ( 0 for zero )
 	int sign;		// -1, 0 or +1
 
 	// constructor
-	BigInt():digits(1,'0'),size(1),sign(0) {};
-	BigInt( const std::string s );
+	BigInt():size(0),sign(0) {};
+	BigInt( const std::string &s );
 	BigInt( DatType n );
 	BigInt( const BigInt &n );
+	BigInt( BigInt &&n );
+	static BigInt FromUint64( uint64_t v );
 
 	// Assignment operators
-	const BigInt &operator=( const BigInt & n );
-	const BigInt &operator=( DatType n );
+	BigInt &operator=( const BigInt &n );
+	BigInt &operator=( BigInt &&n );
+	BigInt &operator=( DatType n );
 
 	// Arithmetic
-	BigInt SubSameSign( BigInt first, BigInt second );
-	BigInt operator-();
+	BigInt SubSameSign( const BigInt &first, const BigInt &second ) const;
+	BigInt operator-() const;
 	BigInt& operator+= ( DatType n );
-	BigInt& operator+= ( BigInt n );
-	BigInt operator+ ( DatType n );
-	BigInt operator+ ( BigInt n );
+	BigInt& operator+= ( const BigInt &n );
+	BigInt operator+ ( DatType n ) const;
+	BigInt operator+ ( const BigInt &n ) const;
 
 	BigInt& operator-=( DatType n );
-	BigInt& operator-=( BigInt n );
-	BigInt operator- ( DatType n );
-	BigInt operator- ( BigInt n );
+	BigInt& operator-=( const BigInt &n );
+	BigInt operator- ( DatType n ) const;
+	BigInt operator- ( const BigInt &n ) const;
 
-	BigInt operator* ( DatType n );
-	BigInt operator* ( BigInt n );
+	BigInt operator* ( DatType n ) const;
+	BigInt operator* ( const BigInt &n ) const;
 	BigInt& operator*= ( DatType n );
-	BigInt& operator*= ( BigInt n );
+	BigInt& operator*= ( const BigInt &n );
 
-	BigInt operator/ ( DatType n );
-	BigInt operator/ ( BigInt n );
+	BigInt operator/ ( DatType n ) const;
+	BigInt operator/ ( const BigInt &n ) const;
 	BigInt& operator/= ( DatType n );
-	BigInt& operator/= ( BigInt n );
+	BigInt& operator/= ( const BigInt &n );
 
-	DatType ModPower2( int pw );
-	DatType operator% ( DatType n );
-	BigInt operator% ( BigInt n );
+	DatType ModPower2( int pw ) const;
+	DatType operator% ( DatType n ) const;
+	BigInt operator% ( const BigInt &n ) const;
 
 	//BigInt& operator%= ( DatType n );
-	//BigInt& operator%= ( BigInt n );
+	BigInt& operator%= ( const BigInt &n );
 
-	// Bitwise arighmetic
-	// BigInt operator>> ( DatType n );
-	// BigInt operator<< ( DatType n );
-	// BigInt& operator>>= ( DatType n );
-	// BigInt& operator<<= ( DatType n );
+	// Bitwise arighmetic ( on the magnitude, the sign is kept )
+	BigInt operator>> ( DatType n ) const;
+	BigInt operator<< ( DatType n ) const;
+	BigInt& operator>>= ( DatType n );
+	BigInt& operator<<= ( DatType n );
 
 	// Comparision
-	int BigCmpr( BigInt n );
-	bool operator==( BigInt n );
-	bool operator!=( BigInt n );
-	bool operator>( BigInt n );
-	bool operator<( BigInt n );
-	bool operator>=( BigInt n);
-	bool operator<=( BigInt n);
-	bool operator==( DatType n );
-	bool operator!=( DatType n );
-	bool operator>( DatType n );
-	bool operator<( DatType n );
-	bool operator>=( DatType n );
-	bool operator<=( DatType n );
-
-	// I/O 
-	friend std::ostream &operator<<( std::ostream &out, BigInt n );
+	int BigCmpr( const BigInt &n ) const;
+	int BigCmpr( DatType n ) const;
+	bool operator==( const BigInt &n ) const;
+	bool operator!=( const BigInt &n ) const;
+	bool operator>( const BigInt &n ) const;
+	bool operator<( const BigInt &n ) const;
+	bool operator>=( const BigInt &n ) const;
+	bool operator<=( const BigInt &n ) const;
+	bool operator==( DatType n ) const;
+	bool operator!=( DatType n ) const;
+	bool operator>( DatType n ) const;
+	bool operator<( DatType n ) const;
+	bool operator>=( DatType n ) const;
+	bool operator<=( DatType n ) const;
+
+	// I/O
+	friend std::ostream &operator<<( std::ostream &out, const BigInt &n );
 	//friend istream &operator>>( istream &in,  BigInt n );
-	
+	std::string ToString() const;
+	uint64_t ToUint64() const;
+
 	// Display
-	void Display();
+	void Display() const;
+
+	// Binary representation helpers
+	void Normalize();
+	SizeType BitLength() const;
+	bool TestBit( SizeType i ) const;
+	LimbType GetBits( SizeType i, int cnt ) const;
+	int CmpAbs( const BigInt &n ) const;
+	void AddSigned( const BigInt &n, int nsign );
+	void AddSigned( const LimbType *b, SizeType bn, int nsign );
+	void DivideAbs( const BigInt &n, BigInt *q, BigInt *r ) const;
+	void DivMod( const BigInt &n, BigInt &q, BigInt &r ) const;
 };
 
-BigInt::BigInt( const std::string s ) {
+inline BigInt ParseDecimal( const std::string &s, SizeType from, SizeType to );
+
+// Strip high zero limbs and fix size and sign for zero
+inline void BigInt::Normalize() {
+	SizeType n = LimbNormSize( limbs.data(), limbs.size() );
+	limbs.resize( n );
+	size = n;
+	if ( size == 0 ) sign = 0;
+}
+
+// Number of significant bits of the magnitude
+inline SizeType BigInt::BitLength() const {
+	if ( size == 0 ) return 0;
+	return size * LIMB_BITS - LimbClz( limbs[size-1] );
+}
+
+// Bit i of the magnitude
+inline bool BigInt::TestBit( SizeType i ) const {
+	if ( i / LIMB_BITS >= size ) return false;
+	return ( limbs[i / LIMB_BITS] >> ( i % LIMB_BITS ) ) & 1;
+}
+
+// Bits [i, i+cnt) of the magnitude as a number, 0 < cnt < LIMB_BITS
+inline LimbType BigInt::GetBits( SizeType i, int cnt ) const {
+	SizeType li = i / LIMB_BITS;
+	int sh = i % LIMB_BITS;
+	if ( li >= size ) return 0;
+	LimbType w = limbs[li] >> sh;
+	if ( sh + cnt > LIMB_BITS && li + 1 < size ) w |= limbs[li+1] << ( LIMB_BITS - sh );
+	return w & ( ( (LimbType)1 << cnt ) - 1 );
+}
+
+// Compare magnitudes
+inline int BigInt::CmpAbs( const BigInt &n ) const {
+	return LimbCmp( limbs.data(), size, n.limbs.data(), n.size );
+}
+
+// *this += nsign * |n|
+inline void BigInt::AddSigned( const BigInt &n, int nsign ) {
+	if ( &n == this ) {
+		BigInt t( n );
+		AddSigned( t.limbs.data(), t.size, nsign );
+	} else {
+		AddSigned( n.limbs.data(), n.size, nsign );
+	}
+}
+
+// *this += nsign * b with b[0..bn) normalized and not aliasing limbs
+inline void BigInt::AddSigned( const LimbType *b, SizeType bn, int nsign ) {
+	if ( nsign == 0 ) return;
+	if ( sign == 0 ) {
+		limbs.assign( b, b + bn );
+		size = bn;
+		sign = nsign;
+		return;
+	}
+
+	if ( sign == nsign ) {
+		SizeType sz = std::max<SizeType>( size, bn ) + 1;
+		limbs.resize( sz, 0 );
+		LimbAdd( limbs.data(), limbs.data(), sz, b, bn );
+	} else {
+		int c = LimbCmp( limbs.data(), size, b, bn );
+		if ( c == 0 ) {
+			limbs.clear();
+		} else if ( c > 0 ) {
+			LimbSub( limbs.data(), limbs.data(), size, b, bn );
+		} else {
+			// |b| - |this|, computed in place after zero extension
+			limbs.resize( bn, 0 );
+			LimbSubN( limbs.data(), b, limbs.data(), bn );
+			sign = nsign;
+		}
+	}
+	Normalize();
+}
+
+// Divide magnitudes: q = |this| / |n|, r = |this| % |n| ( q or r may be NULL )
+inline void BigInt::DivideAbs( const BigInt &n, BigInt *q, BigInt *r ) const {
+	BigInt quo, rem;
+	if ( CmpAbs( n ) < 0 ) {
+		rem = *this;
+		if ( rem.sign != 0 ) rem.sign = 1;
+	} else if ( n.size == 1 ) {
+		quo.limbs.resize( size );
+		LimbType rs = LimbDivMod1( quo.limbs.data(), limbs.data(), size, n.limbs[0] );
+		quo.sign = 1;
+		quo.Normalize();
+		if ( rs ) {
+			rem.limbs.assign( 1, rs );
+			rem.size = 1;
+			rem.sign = 1;
+		}
+	} else {
+		LimbVector ws( size + n.size + 1 );
+		quo.limbs.resize( size - n.size + 1 );
+		rem.limbs.resize( n.size );
+		LimbDivRem( quo.limbs.data(), rem.limbs.data(), limbs.data(), size, n.limbs.data(), n.size, ws.data() );
+		quo.sign = 1;
+		quo.Normalize();
+		rem.sign = 1;
+		rem.Normalize();
+	}
+	if ( q ) *q = std::move( quo );
+	if ( r ) *r = std::move( rem );
+}
+
+// Quotient and remainder in one division, truncated like operator/ and operator%
+inline void BigInt::DivMod( const BigInt &n, BigInt &q, BigInt &r ) const {
+	int qsign = sign * n.sign, rsign = sign;
+	if ( n.sign == 0 ) rsign /= n.sign;
+	DivideAbs( n, &q, &r );
+	if ( q.sign != 0 ) q.sign = qsign;
+	if ( r.sign != 0 ) r.sign = rsign;
+}
+
+inline BigInt::BigInt( const std::string &s ) {
 	SizeType sz = s.size();
 	SizeType i = 0;
-	sign = 1;
-	if ( s[0] == '-' ) {
-		sign = -1;
+	int sg = 1;
+	if ( sz > 0 && s[0] == '-' ) {
+		sg = -1;
 		i++;
 	}
-	while ( s[i] == '0' && i < sz ) i++;
-	if ( i == sz ) {
-		sign = 0;
-		size = 1;
-		digits = "0";
-	}
-	else {
-		sign *= 1;
-		digits = s.substr( i );
-		size = sz - i;
-	}
+	while ( i < sz && s[i] == '0' ) i++;
+	*this = ParseDecimal( s, i, sz );
+	if ( sign != 0 ) sign = sg;
 }
 
-BigInt::BigInt( DatType n ) {
-	std::stringstream ss;
-	ss << n;
-	const std::string s = ss.str();
-	BigInt rs( s );
-	digits = rs.digits;
-	size = rs.size;
-	sign = rs.sign;
+inline BigInt::BigInt( DatType n ) {
+	operator=( n );
 }
 
-BigInt::BigInt( const BigInt &n ) {
-	digits = n.digits;
+inline BigInt::BigInt( const BigInt &n ) {
+	limbs.assign( n.limbs.begin(), n.limbs.begin() + n.size );
 	size = n.size;
 	sign = n.sign;
 }
 
-SizeType GenRand( SizeType start, SizeType end ) {
-	SizeType a = randomEngine() % (end+1 - start) + start;
+// The limbs are taken over, n is left as zero
+inline BigInt::BigInt( BigInt &&n ):limbs( std::move( n.limbs ) ),size( n.size ),sign( n.sign ) {
+	n.limbs.clear();
+	n.size = 0;
+	n.sign = 0;
+}
+
+inline SizeType GenRand( SizeType start, SizeType end ) {
+	SizeType a = ThreadRng().Below( end + 1 - start ) + start;
 	return a;
 }
 
-const BigInt &BigInt::operator=( const BigInt &n ) {
+inline BigInt &BigInt::operator=( const BigInt &n ) {
 	if ( &n != this ) {
-		digits = n.digits;
+		limbs.assign( n.limbs.begin(), n.limbs.begin() + n.size );
 		size = n.size;
 		sign = n.sign;
 	}
 	return *this;
 }
 
-const BigInt &BigInt::operator=( const DatType n ) {
-	BigInt rs( n );
-	if ( &rs != this ) {
-		digits = rs.digits;
-		size = rs.size;
-		sign = rs.sign;
-	}	
+inline BigInt &BigInt::operator=( BigInt &&n ) {
+	if ( &n != this ) {
+		limbs.swap( n.limbs );
+		size = n.size;
+		sign = n.sign;
+		n.limbs.clear();
+		n.size = 0;
+		n.sign = 0;
+	}
 	return *this;
 }
 
-BigInt &BigInt::operator+=( BigInt n ) {
-	if ( n.sign == 0 ) return *this;
-	if ( sign == 0 ) {
-		sign = n.sign;
-		digits = n.digits;
-		size = n.size;
-		return *this;
-	}
+// In place, the limbs keep their capacity
+inline BigInt &BigInt::operator=( DatType n ) {
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	LimbType tmp[2];
+	size = LimbFromU64( tmp, mag );
+	limbs.assign( tmp, tmp + size );
+	sign = ( n > 0 ) - ( n < 0 );
+	return *this;
+}
 
-	SizeType sz = std::max<SizeType>( size, n.size ) + 1;
-	std::string ds( sz, '0' );
-
-	if ( sign == n.sign ) {
-		int carry = 0;
-		for ( SizeType i = 0; i < sz || carry; i++ ) {
-			int newdig = carry;
-			if ( i < size ) newdig += (digits[size-1-i] - '0');
-			if ( i < n.size) newdig += (n.digits[n.size-1-i] - '0');
-			int dc = newdig % 10;
-			ds[sz-1-i] = '0' + dc ;
-			carry = newdig / 10;
-		}
-		BigInt rs( ds );
-		digits = rs.digits;
-		size = rs.size;
-	} else {
-		n.sign *= -1;
-		operator -=( n );
-		n.sign *= -1;
-	}
+inline BigInt &BigInt::operator+=( const BigInt &n ) {
+	AddSigned( n, n.sign );
 	return *this;
 }
 
-BigInt &BigInt::operator+=( DatType n ) {
-	BigInt result( n );
-	operator +=( result );
+// Word operands are added from a limb buffer on the stack
+inline BigInt &BigInt::operator+=( DatType n ) {
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	LimbType tmp[2];
+	SizeType tn = LimbFromU64( tmp, mag );
+	AddSigned( tmp, tn, ( n > 0 ) - ( n < 0 ) );
 	return *this;
 }
 
-BigInt BigInt::operator+( BigInt n ) {
+inline BigInt BigInt::operator+( const BigInt &n ) const {
 	BigInt result(*this);
 	result += n;
 	return result;
 }
 
-BigInt BigInt::operator+( DatType n ) {
+inline BigInt BigInt::operator+( DatType n ) const {
 	BigInt result(*this);
 	result += n;
 	return result;
 }
 
 // substraction of two numbers ( same sign )
-BigInt BigInt::SubSameSign( BigInt first, BigInt second ){
-	if ( first == second ) return BigInt();
-	
-	SizeType sz = std::max<SizeType>( first.size, second.size );
-	std::string ds( sz, '0' );
-	int sign = 1;
-	bool sgflag = 0;
-	if ( first.sign == -1 ) {
-		first.sign *= -1;
-		second.sign *= -1;
-		sign = -1;
-		sgflag = 1;
-	}
-
-	if ( first < second ) sign *= -1;
-
-	BigInt large = (first > second)?first:second;
-	BigInt small = (first < second)?first:second;
-
-	SizeType lsz = large.size;
-	SizeType ssz = small.size;
-
-	int carry = 0;
-	for ( SizeType i = 0; i < sz; i++ ) {
-		int newdig = carry;
-		if ( i < lsz )  newdig += (large.digits[lsz-1-i] - '0');
-		if ( i < ssz )  newdig -= (small.digits[ssz-1-i] - '0');
-		if ( newdig < 0 ) {
-			newdig += 10;
-			carry = -1;
-		} else carry = 0;
-		ds[sz-1-i] = newdig + '0';
-	}
-	BigInt rs( ds );
-	rs.sign *= sign;
-	if ( sgflag == 1) {
-		first.sign = -1;
-		second.sign = -1;
-	}
+inline BigInt BigInt::SubSameSign( const BigInt &first, const BigInt &second ) const {
+	BigInt rs( first );
+	rs.AddSigned( second, -second.sign );
 	return rs;
 }
 
-BigInt BigInt::operator-() {
+inline BigInt BigInt::operator-() const {
 	BigInt result( *this );
 	result.sign *= -1;
 	return result;
 }
 
-BigInt &BigInt::operator-=( BigInt n ) {
-	if ( n.sign == 0 ) return *this;
-	if ( sign == 0 ) {
-		sign = n.sign * (-1);
-		digits = n.digits;
-		size = n.size;
-		return *this;
-	}
-
-	if ( sign == n.sign ) {
-		BigInt rs = SubSameSign( *this, n );
-		sign = rs.sign;
-		digits = rs.digits;
-		size = rs.size;
-	} else {
-		n.sign *= -1;
-		operator +=( n );
-		n.sign *= -1;
-	}
+inline BigInt &BigInt::operator-=( const BigInt &n ) {
+	AddSigned( n, -n.sign );
 	return *this;
 }
 
-BigInt &BigInt::operator-=( DatType n ) {
-	BigInt result( n );
-	operator -=( result );
+inline BigInt &BigInt::operator-=( DatType n ) {
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	LimbType tmp[2];
+	SizeType tn = LimbFromU64( tmp, mag );
+	AddSigned( tmp, tn, ( n < 0 ) - ( n > 0 ) );
 	return *this;
 }
 
-BigInt BigInt::operator-( BigInt n ) {
+inline BigInt BigInt::operator-( const BigInt &n ) const {
 	BigInt result(*this);
 	result -= n;
 	return result;
 }
 
-BigInt BigInt::operator-( DatType n ) {
+inline BigInt BigInt::operator-( DatType n ) const {
 	BigInt result(*this);
 	result -= n;
 	return result;
 }
 
-BigInt BigInt::operator*( BigInt n ) {
+inline BigInt BigInt::operator*( const BigInt &n ) const {
 	int rs_sign = sign * n.sign;
 	if ( rs_sign == 0 ) return BigInt();
-	if ( n == 10 ){
-		BigInt rs = *this;
-		rs.digits.append("0");
-		rs.size++;
-		return rs;
-	}
-	std::string ds( size + n.size, '0' );
-	SizeType sz = size + n.size;
-	SizeType i, j;
-	int carry = 0;
-	for ( i = n.size - 1; i >= 0; i-- ) {
-		if ( n.digits[i] ) {
-			carry = 0;
-			for ( j = size - 1; j >= 0 || carry; j-- ) {
-				int jdg = ( j >= 0)?(digits[j] - '0'):0;
-				int newDig = (ds[i+j+1] - '0') + (n.digits[i] - '0')*jdg + carry;
-				ds[i+j+1] = '0' + newDig % 10;
-				carry = newDig / 10;
-			}
-		}
-	}
-
-	BigInt result( ds );
+	BigInt result;
+	result.limbs.resize( size + n.size );
+	if ( &n == this || ( size == n.size && limbs == n.limbs ) )
+		LimbSqrN( result.limbs.data(), limbs.data(), size );
+	else if ( size >= n.size )
+		LimbMul( result.limbs.data(), limbs.data(), size, n.limbs.data(), n.size );
+	else
+		LimbMul( result.limbs.data(), n.limbs.data(), n.size, limbs.data(), size );
 	result.sign = rs_sign;
+	result.Normalize();
 	return result;
 }
 
-BigInt BigInt::operator*( DatType n ) {
-	BigInt tmp( n );
-	BigInt result = (*this) * tmp;
+inline BigInt BigInt::operator*( DatType n ) const {
+	BigInt result( *this );
+	result *= n;
 	return result;
 }
 
-BigInt &BigInt::operator*=( DatType n ) {
-	operator=( operator*( n ) );
+// Word multipliers scale the limbs in place
+inline BigInt &BigInt::operator*=( DatType n ) {
+	if ( sign == 0 || n == 0 ) return operator=( 0 );
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	if ( mag > LIMB_MAX ) return operator*=( BigInt( n ) );
+	limbs.resize( size + 1 );
+	limbs[size] = LimbMul1( limbs.data(), limbs.data(), size, (LimbType)mag );
+	if ( n < 0 ) sign = -sign;
+	Normalize();
 	return (*this);
 }
 
-BigInt &BigInt::operator*=( BigInt n ) {
-	operator=( operator*( n ) );
-	return (*this);
+inline BigInt &BigInt::operator*=( const BigInt &n ) {
+	return operator=( operator*( n ) );
 }
 
-BigInt BigInt::operator/ ( BigInt n ) {
+inline BigInt BigInt::operator/ ( const BigInt &n ) const {
 	BigInt result( *this );
 	result /= n;
 	return result;
 }
 
-BigInt &BigInt::operator/=( BigInt n ) {
-	if ( n.sign == 0 ) n.sign /= n.sign;
+inline BigInt &BigInt::operator/=( const BigInt &n ) {
+	int nsign = n.sign;
+	if ( nsign == 0 ) nsign /= nsign;
 	if ( sign == 0 ) return *this;
-	sign *= n.sign;
-	int prevSign = n.sign;
-	n.sign = 1;
+	int rs_sign = sign * nsign;
 	BigInt q;
-	for ( SizeType i = 0; i < size; ++i ) {		
-		const std::string str(1,digits[i]);
-		if ( q.sign != 0 ) {
-			q.digits.append(str);
-			q.size++;
-		} else {
-			q.digits = str;
-			q.size = 1;
-			q.sign = ( digits[i] == '0' )?0:1;
-		}
-		digits[i] = '0';
-		while ( q >= n ) {
-			q -= n;
-			digits[i] = digits[i] + ('1' - '0') ;
-		}
-	}
-	n.sign = prevSign;
-	BigInt tmp( digits );
-	digits = tmp.digits;
-	size = tmp.size;
-	if ( tmp.sign == 0 ) sign = 0;
-	return *this;	
+	DivideAbs( n, &q, NULL );
+	limbs.swap( q.limbs );
+	size = q.size;
+	sign = ( size == 0 )?0:rs_sign;
+	return *this;
 }
 
-BigInt BigInt::operator/ ( DatType n ) {
-	BigInt tmp( n );
-	BigInt result = (*this) / tmp;
+inline BigInt BigInt::operator/ ( DatType n ) const {
+	BigInt result( *this );
+	result /= n;
 	return result;
 }
 
-BigInt &BigInt::operator/=( DatType n ) {
-	BigInt tmp( n );
-	(*this) /= tmp;
+inline BigInt &BigInt::operator/=( DatType n ) {
+	if ( n == 0 ) n /= n;
+	if ( sign == 0 ) return *this;
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	if ( mag > LIMB_MAX ) {
+		BigInt tmp( n );
+		return (*this) /= tmp;
+	}
+	LimbDivMod1( limbs.data(), limbs.data(), size, (LimbType)mag );
+	if ( n < 0 ) sign *= -1;
+	Normalize();
 	return *this;
 }
 
-// Module of 2^(pw)
-DatType BigInt::ModPower2( int pw ) {
-	DatType rs = 0;
+// Module of 2^(pw+1) of the magnitude
+inline DatType BigInt::ModPower2( int pw ) const {
+	if ( size == 0 ) return 0;
 	DatType n = 2 << pw;
-	const int min_in = std::max<int>( 0, size - pw - 1 );
-	for ( int i = min_in; i < size; i++ ) {
-		rs *= 10;
-		rs += (digits[i]-'0');
-	}
-	return rs%n;
+	return (DatType)( limbs[0] & (LimbType)( n - 1 ) );
 }
 
-BigInt BigInt::operator% ( BigInt n ) {
-	if ( n.sign == 0 ) n.sign /= n.sign;
+// Remainder with the sign of the dividend
+inline BigInt BigInt::operator% ( const BigInt &n ) const {
+	int nsign = n.sign;
+	if ( nsign == 0 ) nsign /= nsign;
 	if ( sign == 0 ) return *this;
 	BigInt r;
-	if ( n == 1 ) { 
-		r.size = 1;
-		r.sign = 0;
-		r.digits = "0";
-		return r; 
-	};
-	
-	int prevSign = n.sign;
-	n.sign = 1;
-
-	for ( int pw = 0; pw  < 3; pw++ ) {
-		if ( n == (2 << pw) ) {
-			DatType rs = ModPower2( pw );
-			const char ch = '0' + rs;
-			const std::string st(1,ch);
-			r.size = 1;
-			r.digits = st;
-			if ( rs ) r.sign = 1;
-			else r.sign = 0;
-			if ( sign != 1 ) r.sign *= -1;
-			return r;
-		}
+	DivideAbs( n, NULL, &r );
+	if ( r.sign != 0 ) r.sign = sign;
+	return r;
+}
+
+inline BigInt &BigInt::operator%=( const BigInt &n ) {
+	int nsign = n.sign;
+	if ( nsign == 0 ) nsign /= nsign;
+	if ( sign == 0 || CmpAbs( n ) < 0 ) return *this;
+	int rsign = sign;
+	DivideAbs( n, NULL, this );
+	if ( sign != 0 ) sign = rsign;
+	return *this;
+}
+
+// Remainder of the magnitude ( non-negative )
+inline DatType BigInt::operator% ( DatType n ) const {
+	if ( n == 0 ) return n/n;
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	if ( mag > LIMB_MAX ) {
+		BigInt q( n );
+		BigInt rs = (*this)%q;
+		return (DatType)rs.ToUint64();
+	}
+	return (DatType)LimbMod1( limbs.data(), size, (LimbType)mag );
+}
+
+inline BigInt &BigInt::operator<<=( DatType n ) {
+	if ( sign == 0 || n <= 0 ) return ( n < 0 )?operator>>=( -n ):*this;
+	SizeType ls = n / LIMB_BITS;
+	int bs = n % LIMB_BITS;
+	limbs.resize( size + ls + 1, 0 );
+	LimbType out = 0;
+	if ( bs ) out = LimbLshift( limbs.data(), limbs.data(), size, bs );
+	limbs[size] = out;
+	if ( ls ) {
+		memmove( limbs.data() + ls, limbs.data(), ( size + 1 ) * sizeof( LimbType ) );
+		memset( limbs.data(), 0, ls * sizeof( LimbType ) );
 	}
+	Normalize();
+	return *this;
+}
 
-	for ( SizeType i = 0; i < size; ++i ) {
-		//r *= 10;
-		//r += (digits[i] - '0');
-		const std::string str(1,digits[i]);
-		if ( r.sign != 0 ) {
-			r.digits.append(str);
-			r.size++;
-		} else {
-			r.digits = str;
-			r.size = 1;
-			r.sign = ( digits[i] == '0' )?0:1;
-		}
-		while ( r >= n ) {
-			r -= n;
-		}
+inline BigInt &BigInt::operator>>=( DatType n ) {
+	if ( sign == 0 || n <= 0 ) return ( n < 0 )?operator<<=( -n ):*this;
+	SizeType ls = n / LIMB_BITS;
+	int bs = n % LIMB_BITS;
+	if ( ls >= size ) {
+		limbs.clear();
+		Normalize();
+		return *this;
 	}
-	n.sign = prevSign;
-	if ( sign != 1 ) r.sign *= -1;
-	return r;
+	if ( ls ) memmove( limbs.data(), limbs.data() + ls, ( size - ls ) * sizeof( LimbType ) );
+	limbs.resize( size - ls );
+	if ( bs ) LimbRshift( limbs.data(), limbs.data(), size - ls, bs );
+	Normalize();
+	return *this;
 }
 
-DatType BigInt::operator% ( DatType n ) {
-	if ( n == 0 ) return n/n;
-	if ( n == 1 ) return 0;
-	if ( n == 2 ) return ModPower2(0);
-	if ( n == 4 ) return ModPower2(1);
-	if ( n == 8 ) return ModPower2(2);
+inline BigInt BigInt::operator<<( DatType n ) const {
+	BigInt result( *this );
+	result <<= n;
+	return result;
+}
 
-	BigInt q(n);
-	BigInt rs = (*this)%q;
-	DatType numb;
-	std::istringstream( rs.digits ) >> numb;
-	return numb;
+inline BigInt BigInt::operator>>( DatType n ) const {
+	BigInt result( *this );
+	result >>= n;
+	return result;
 }
 
-BigInt operator+( DatType m, BigInt &n ) {
+inline BigInt operator+( DatType m, const BigInt &n ) {
     return n + m;
 }
 
-BigInt operator-( DatType m, BigInt &n ) {
+inline BigInt operator-( DatType m, const BigInt &n ) {
     return -n + m;
 }
 
-BigInt operator*( DatType m, BigInt &n ) {
+inline BigInt operator*( DatType m, const BigInt &n ) {
     return n * m;
 }
 
-BigInt operator/( DatType m, BigInt &n ) {
+inline BigInt operator/( DatType m, const BigInt &n ) {
     return BigInt( m ) / n;
 }
 
-BigInt operator%( DatType m, BigInt &n ) {
+inline BigInt operator%( DatType m, const BigInt &n ) {
     return BigInt( m ) % n;
 }
 
-int BigInt::BigCmpr( BigInt n ) {
+inline int BigInt::BigCmpr( const BigInt &n ) const {
 	if ( sign < n.sign ) return -1;
 	if ( sign > n.sign ) return 1;
-	if ( size < n.size ) return -sign;
-	if ( size > n.size ) return sign;
-	for ( SizeType i = 0; i < size; i++ ) {
-		if ( digits[i] < n.digits[i] ) return -sign;
-		else if ( digits[i] > n.digits[i] ) return sign;
-	}
-	return 0;
+	return sign * CmpAbs( n );
+}
+
+inline int BigInt::BigCmpr( DatType n ) const {
+	int nsign = ( n > 0 ) - ( n < 0 );
+	if ( sign < nsign ) return -1;
+	if ( sign > nsign ) return 1;
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	LimbType tmp[2];
+	SizeType tn = LimbFromU64( tmp, mag );
+	return sign * LimbCmp( limbs.data(), size, tmp, tn );
+}
+
+inline bool BigInt::operator<( const BigInt &n ) const {
+    return( BigCmpr( n ) < 0 );
+}
+
+inline bool BigInt::operator>( const BigInt &n ) const {
+    return( BigCmpr( n ) > 0 );
+}
+
+inline bool BigInt::operator==( const BigInt &n ) const {
+    return( BigCmpr( n ) == 0 );
+}
+
+inline bool BigInt::operator!=( const BigInt &n ) const {
+    return( BigCmpr( n ) != 0 );
+}
+
+inline bool BigInt::operator<=( const BigInt &n ) const {
+    return( BigCmpr( n ) <= 0 );
+}
+
+inline bool BigInt::operator>=( const BigInt &n ) const {
+    return( BigCmpr( n ) >= 0 );
 }
 
-bool BigInt::operator<( BigInt n ) {
+inline bool BigInt::operator<( DatType n ) const {
     return( BigCmpr( n ) < 0 );
 }
 
-bool BigInt::operator>( BigInt n ) {
+inline bool BigInt::operator>( DatType n ) const {
     return( BigCmpr( n ) > 0 );
 }
 
-bool BigInt::operator==( BigInt n ) {
+inline bool BigInt::operator==( DatType n ) const {
     return( BigCmpr( n ) == 0 );
 }
 
-bool BigInt::operator!=( BigInt n ) {
+inline bool BigInt::operator!=( DatType n ) const {
     return( BigCmpr( n ) != 0 );
 }
 
-bool BigInt::operator<=( BigInt n ) {
+inline bool BigInt::operator<=( DatType n ) const {
     return( BigCmpr( n ) <= 0 );
 }
 
-bool BigInt::operator>=( BigInt n ) {
+inline bool BigInt::operator>=( DatType n ) const {
     return( BigCmpr( n ) >= 0 );
 }
 
-bool BigInt::operator<( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) < 0 );
+// Radix conversion: below RADIX_DC_THRESHOLD limbs the digits are produced
+// by Horner's rule or by repeated division by 10^LIMB_DIGITS, larger numbers
+// are split at a power 10^(LIMB_DIGITS*2^k) ( one product to parse, one
+// division by the cached reciprocal to print ), O(M(n) log n) in total
+const SizeType RADIX_DC_THRESHOLD = 40;
+
+struct RadixPower {
+	BigInt pow;		// 10^digits
+	SizeType digits;	// LIMB_DIGITS * 2^k
+	SizeType bits;		// bit length of pow
+	BigInt inv;		// floor( 2^(2*bits) / pow ), zero until a division needs it
+};
+
+// Reciprocal floor( 2^(2n) / p ) of p with n bits, a Newton step from the
+// reciprocal of the top half of p and a final correction by remainder
+inline BigInt Reciprocal( const BigInt &p ) {
+	SizeType n = p.BitLength();
+	BigInt one = BigInt( 1 ) << (DatType)( 2 * n ), r;
+	if ( p.size <= RADIX_DC_THRESHOLD ) {
+		r = one / p;
+	} else {
+		SizeType h = n / 2 + 1;
+		r = Reciprocal( p >> (DatType)( n - h ) ) << (DatType)( n - h );
+		BigInt e = one - p * r;
+		r += ( r * e ) >> (DatType)( 2 * n );
+	}
+	BigInt e = one - p * r;
+	while ( e.sign < 0 ) {
+		r -= 1;
+		e += p;
+	}
+	while ( e >= p ) {
+		r += 1;
+		e -= p;
+	}
+	return r;
 }
 
-bool BigInt::operator>( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) > 0 );
+// 10^(LIMB_DIGITS*2^k), squared up once per thread and kept ( a deque, so
+// references stay valid while higher powers are added )
+inline RadixPower &RadixPowerAt( SizeType k ) {
+	static thread_local std::deque<RadixPower> powers;
+	while ( (SizeType)powers.size() <= k ) {
+		RadixPower P;
+		if ( powers.empty() ) {
+			P.pow = BigInt::FromUint64( LIMB_DECBASE );
+			P.digits = LIMB_DIGITS;
+		} else {
+			P.pow = powers.back().pow * powers.back().pow;
+			P.digits = 2 * powers.back().digits;
+		}
+		P.bits = P.pow.BitLength();
+		powers.push_back( std::move( P ) );
+	}
+	return powers[k];
 }
 
-bool BigInt::operator==( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) == 0 );
+// q = x / P.pow, r = x % P.pow for 0 <= x < P.pow^2, Barrett reduction on the top bits
+inline void RadixDivMod( const BigInt &x, RadixPower &P, BigInt &q, BigInt &r ) {
+	if ( P.inv.sign == 0 ) P.inv = Reciprocal( P.pow );
+	q = ( ( x >> (DatType)( P.bits - 1 ) ) * P.inv ) >> (DatType)( P.bits + 1 );
+	r = x - q * P.pow;
+	while ( r >= P.pow ) {
+		r -= P.pow;
+		q += 1;
+	}
 }
 
-bool BigInt::operator!=( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) != 0 );
+// Value of the decimal digits s[from, to)
+inline BigInt ParseDecimal( const std::string &s, SizeType from, SizeType to ) {
+	SizeType len = to - from;
+	if ( len > RADIX_DC_THRESHOLD * LIMB_DIGITS ) {
+		SizeType k = 0;
+		while ( 2 * RadixPowerAt( k ).digits < len ) k++;
+		const RadixPower &P = RadixPowerAt( k );
+		BigInt rs = ParseDecimal( s, from, to - P.digits ) * P.pow;
+		rs += ParseDecimal( s, to - P.digits, to );
+		return rs;
+	}
+
+	// Horner over chunks of LIMB_DIGITS decimal digits, the first chunk may be shorter
+	BigInt rs;
+	SizeType chunk = len % LIMB_DIGITS;
+	if ( chunk == 0 ) chunk = LIMB_DIGITS;
+	for ( SizeType i = from; i < to; ) {
+		LimbType value = 0, base = 1;
+		for ( SizeType j = 0; j < chunk; j++, i++ ) {
+			value = value * 10 + ( s[i] - '0' );
+			base *= 10;
+		}
+		LimbType carry = LimbMul1( rs.limbs.data(), rs.limbs.data(), rs.size, base );
+		carry += LimbAdd1( rs.limbs.data(), rs.limbs.data(), rs.size, value );
+		if ( carry ) rs.limbs.push_back( carry );
+		rs.size = rs.limbs.size();
+		chunk = LIMB_DIGITS;
+	}
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
 }
 
-bool BigInt::operator<=( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) <= 0 );
+// Append the decimal digits of x >= 0, left padded with zeros to width digits
+inline void AppendDecimal( const BigInt &x, SizeType width, std::string &out ) {
+	if ( x.size >= RADIX_DC_THRESHOLD ) {
+		// smallest power whose square ( the next power ) exceeds x, so that the
+		// quotient is below it
+		SizeType k = 0;
+		while ( x >= RadixPowerAt( k + 1 ).pow ) k++;
+		RadixPower &P = RadixPowerAt( k );
+		BigInt q, r;
+		RadixDivMod( x, P, q, r );
+		AppendDecimal( q, ( width > P.digits )?width - P.digits:0, out );
+		AppendDecimal( r, P.digits, out );
+		return;
+	}
+
+	// repeated division by 10^LIMB_DIGITS
+	std::vector<LimbType> tmp( x.limbs.begin(), x.limbs.begin() + x.size );
+	std::vector<LimbType> chunks;
+	SizeType n = x.size;
+	while ( n > 0 ) {
+		chunks.push_back( LimbDivMod1( tmp.data(), tmp.data(), n, LIMB_DECBASE ) );
+		n = LimbNormSize( tmp.data(), n );
+	}
+	char buf[LIMB_DIGITS];
+	std::string ds;
+	for ( SizeType i = chunks.size() - 1; i >= 0; i-- ) {
+		LimbType c = chunks[i];
+		int j = LIMB_DIGITS;
+		do {
+			buf[--j] = '0' + c % 10;
+			c /= 10;
+		} while ( c != 0 || ( i + 1 < (SizeType)chunks.size() && j > 0 ) );
+		ds.append( buf + j, LIMB_DIGITS - j );
+	}
+	if ( x.size == 0 ) ds = ( width > 0 )?"":"0";
+	if ( width > (SizeType)ds.size() ) out.append( width - ds.size(), '0' );
+	out += ds;
+}
+
+// Decimal string
+inline std::string BigInt::ToString() const {
+	if ( sign == 0 ) return "0";
+	std::string ds = ( sign == -1 )?"-":"";
+	if ( sign < 0 ) {
+		BigInt mag( *this );
+		mag.sign = 1;
+		AppendDecimal( mag, 0, ds );
+	} else {
+		AppendDecimal( *this, 0, ds );
+	}
+	return ds;
+}
+
+inline BigInt BigInt::FromUint64( uint64_t v ) {
+	LimbType tmp[2];
+	BigInt rs;
+	rs.size = LimbFromU64( tmp, v );
+	rs.limbs.assign( tmp, tmp + rs.size );
+	rs.sign = ( rs.size > 0 )?1:0;
+	return rs;
+}
+
+// Low 64 bits of the magnitude
+inline uint64_t BigInt::ToUint64() const {
+	return LimbToU64( limbs.data(), std::min<SizeType>( size, 64 / LIMB_BITS ) );
+}
+
+// Magnitude of n as 64-bit words, least significant first
+inline void BigIntToWords( const BigInt &n, std::vector<uint64_t> &words ) {
+	const SizeType per = 64 / LIMB_BITS;
+	words.resize( ( n.size + per - 1 ) / per );
+	for ( size_t i = 0; i < words.size(); i++ ) {
+		SizeType at = i * per;
+		words[i] = LimbToU64( n.limbs.data() + at, std::min<SizeType>( per, n.size - at ) );
+	}
 }
 
-bool BigInt::operator>=( DatType n ) {
-    return( BigCmpr( BigInt( n ) ) >= 0 );
+// Non-negative BigInt of count little endian words at p
+inline BigInt BigIntFromWords( const uint8_t *p, SizeType count ) {
+	const SizeType per = 64 / LIMB_BITS;
+	BigInt rs;
+	rs.limbs.resize( count * per );
+	for ( SizeType i = 0; i < count; i++ ) {
+		uint64_t w = LoadLE( p + 8 * i, 8 );
+		for ( SizeType j = 0; j < per; j++ ) rs.limbs[i*per+j] = (LimbType)( w >> ( ( j * LIMB_BITS ) % 64 ) );
+	}
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
 }
 
 // I/O friends
-std::ostream &operator<<( std::ostream &out, BigInt n ) {
-	if ( n.sign == -1) return out << "-" << n.digits;
-	else return out << n.digits;
+inline std::ostream &operator<<( std::ostream &out, const BigInt &n ) {
+	return out << n.ToString();
 }
 
 // Display the string
-void BigInt::Display() {
-	if ( sign == -1 ) std::cout << "-";
-	std::cout << digits << std::endl;
+inline void BigInt::Display() const {
+	std::cout << ToString() << std::endl;
+}
+
+// Generate a non-negative integer with size <= sz limbs
+inline BigInt RandBigIntSize( SizeType sz ) {
+	SizeType s_t = GenRand(1,sz);
+	BigInt rs;
+	rs.limbs.resize( s_t );
+	ThreadRng().Fill( rs.limbs.data(), s_t );
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
+}
+
+// Generate a non-negative integer below 2^bits
+inline BigInt RandBigIntBits( SizeType bits ) {
+	BigInt rs;
+	SizeType s_t = ( bits + LIMB_BITS - 1 ) / LIMB_BITS;
+	rs.limbs.resize( s_t );
+	ThreadRng().Fill( rs.limbs.data(), s_t );
+	if ( bits % LIMB_BITS ) rs.limbs[s_t-1] &= ( (LimbType)1 << ( bits % LIMB_BITS ) ) - 1;
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
 }
 
-// Generate a non-negative integer with size <= sz
-BigInt RandBigIntSize( SizeType sz ) {
-	SizeType s_t = GenRand(1,sz); 
-	std::string ds(s_t, '0' );
-	for ( SizeType i = 0; i < s_t; i++ ) ds[i] = '0' + GenRand(0,9);
-	BigInt::BigInt rs( ds );
+// Generate a uniform integer in [0, |m|) for m != 0
+// The top limb is drawn first below the top bit of m and rejected on its own
+// when it is larger than the top limb of m, the lower limbs only when equal
+inline BigInt RandBigIntBelow( const BigInt &m ) {
+	WitnessRng &rng = ThreadRng();
+	SizeType n = m.size;
+	LimbType mtop = m.limbs[n-1];
+	LimbType mask = LIMB_MAX >> ( LIMB_BITS - 1 - ( m.BitLength() - 1 ) % LIMB_BITS );
+	BigInt rs;
+	rs.limbs.resize( n );
+	while ( true ) {
+		LimbType top;
+		rng.Fill( &top, 1 );
+		top &= mask;
+		if ( top > mtop ) continue;
+		rs.limbs[n-1] = top;
+		rng.Fill( rs.limbs.data(), n - 1 );
+		if ( top < mtop || LimbCmp( rs.limbs.data(), m.limbs.data(), n ) < 0 ) break;
+	}
+	rs.sign = 1;
+	rs.Normalize();
 	return rs;
-}
\ No newline at end of file
+}
+
+#endif
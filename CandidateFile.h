@@ -0,0 +1,325 @@
+/*************************************************************************
+*
+* Header file CandidateFile.h
+*	binary candidate files: length prefixed little endian 64-bit words
+*	behind a header, with an offset index every CANDIDATE_INDEX_STRIDE
+*	records; the tester maps a file and streams it block by block
+*	through the batch test, the verdicts go to a bitmap file
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef CANDIDATEFILE_H
+#define CANDIDATEFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "BigInt.h"
+#include "ProbablePrime.h"
+
+// Candidate file ( all integers little endian ):
+//   header   magic "SSCAND01", version u32, word bits u32 ( 64 ), count u64,
+//            index offset u64, index entries u64
+//   records  length u32 ( in words ), then the words of the magnitude,
+//            least significant first
+//   index    offset u64 of the records 0, STRIDE, 2*STRIDE, ...
+// Verdict file: magic "SSBITS01", count u64, then ( count + 63 ) / 64 words,
+// bit i of word i/64 set iff candidate i is probably prime
+const char CANDIDATE_MAGIC[] = "SSCAND01";
+const char VERDICT_MAGIC[] = "SSBITS01";
+const uint32_t CANDIDATE_VERSION = 1;
+const uint64_t CANDIDATE_HEADER_SIZE = 40;
+const uint64_t CANDIDATE_INDEX_STRIDE = 4096;	// records per index entry, also the streaming block
+const uint32_t CANDIDATE_MAX_WORDS = 1 << 24;	// longest record accepted ( 2^30 bits )
+
+struct CandidateWriter {
+	FILE *file;
+	uint64_t count;			// records written
+	uint64_t offset;		// file offset of the next record
+	std::vector<uint64_t> index;
+	std::vector<uint64_t> words;
+	std::vector<uint8_t> buf;
+	std::string error;
+
+	CandidateWriter():file(NULL),count(0),offset(0) {};
+	~CandidateWriter() { if ( file ) fclose( file ); };
+
+	bool Open( const std::string &path );
+	bool Append( const BigInt &n );
+	bool Close();
+	bool Fail( const std::string &what ) { error = what; return false; };
+};
+
+inline bool CandidateWriter::Open( const std::string &path ) {
+	file = fopen( path.c_str(), "wb" );
+	if ( file == NULL ) return Fail( "cannot create " + path );
+	// the header is written again by Close once the count is known
+	uint8_t head[CANDIDATE_HEADER_SIZE] = { 0 };
+	if ( fwrite( head, 1, sizeof( head ), file ) != sizeof( head ) ) return Fail( "write error on " + path );
+	count = 0;
+	offset = CANDIDATE_HEADER_SIZE;
+	index.clear();
+	return true;
+}
+
+// n must be non-negative and fit in CANDIDATE_MAX_WORDS words, as the reader checks
+inline bool CandidateWriter::Append( const BigInt &n ) {
+	if ( n.sign < 0 ) return Fail( "negative candidate" );
+	if ( n.BitLength() > 64 * (SizeType)CANDIDATE_MAX_WORDS ) {
+		return Fail( "candidate of " + std::to_string( n.BitLength() ) + " bits, longer than the "
+			+ std::to_string( 64 * (SizeType)CANDIDATE_MAX_WORDS ) + " bits of a record" );
+	}
+	if ( count % CANDIDATE_INDEX_STRIDE == 0 ) index.push_back( offset );
+	BigIntToWords( n, words );
+	buf.resize( 4 + 8 * words.size() );
+	StoreLE( buf.data(), words.size(), 4 );
+	for ( size_t i = 0; i < words.size(); i++ ) StoreLE( buf.data() + 4 + 8 * i, words[i], 8 );
+	if ( fwrite( buf.data(), 1, buf.size(), file ) != buf.size() ) return Fail( "write error" );
+	offset += buf.size();
+	count++;
+	return true;
+}
+
+inline bool CandidateWriter::Close() {
+	uint8_t head[CANDIDATE_HEADER_SIZE], entry[8];
+	for ( size_t i = 0; i < index.size(); i++ ) {
+		StoreLE( entry, index[i], 8 );
+		if ( fwrite( entry, 1, 8, file ) != 8 ) return Fail( "write error" );
+	}
+	memcpy( head, CANDIDATE_MAGIC, 8 );
+	StoreLE( head + 8, CANDIDATE_VERSION, 4 );
+	StoreLE( head + 12, 64, 4 );
+	StoreLE( head + 16, count, 8 );
+	StoreLE( head + 24, offset, 8 );
+	StoreLE( head + 32, index.size(), 8 );
+	bool ok = fseek( file, 0, SEEK_SET ) == 0 && fwrite( head, 1, sizeof( head ), file ) == sizeof( head );
+	ok = ( fclose( file ) == 0 ) && ok;
+	file = NULL;
+	return ok || Fail( "write error" );
+}
+
+// Read only mapping of a candidate file, checked once at Open and record by
+// record while reading
+struct CandidateReader {
+	int fd;
+	const uint8_t *data;
+	uint64_t length;
+	uint64_t count;
+	uint64_t indexOffset;
+	uint64_t indexCount;
+	std::string error;
+
+	CandidateReader():fd(-1),data(NULL),length(0),count(0),indexOffset(0),indexCount(0) {};
+	~CandidateReader() { Close(); };
+
+	bool Open( const std::string &path );
+	void Close();
+	uint64_t Offset( uint64_t block ) const { return LoadLE( data + indexOffset + 8 * block, 8 ); };
+	bool Read( uint64_t first, uint64_t n, std::vector<BigInt> &out );
+	void Release( uint64_t first, uint64_t n );
+	bool Fail( const std::string &what ) { error = what; return false; };
+};
+
+inline bool CandidateReader::Open( const std::string &path ) {
+	Close();
+	fd = open( path.c_str(), O_RDONLY );
+	if ( fd < 0 ) return Fail( "cannot open " + path );
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || (uint64_t)st.st_size < CANDIDATE_HEADER_SIZE ) return Fail( path + " is not a candidate file" );
+	length = st.st_size;
+	void *p = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if ( p == MAP_FAILED ) return Fail( "cannot map " + path );
+	data = (const uint8_t *)p;
+	madvise( p, length, MADV_SEQUENTIAL );
+
+	if ( memcmp( data, CANDIDATE_MAGIC, 8 ) != 0 ) return Fail( path + " is not a candidate file" );
+	if ( LoadLE( data + 8, 4 ) != CANDIDATE_VERSION || LoadLE( data + 12, 4 ) != 64 ) return Fail( path + ": unsupported version" );
+	count = LoadLE( data + 16, 8 );
+	indexOffset = LoadLE( data + 24, 8 );
+	indexCount = LoadLE( data + 32, 8 );
+	if ( indexOffset < CANDIDATE_HEADER_SIZE || indexOffset > length || indexCount > ( length - indexOffset ) / 8
+		|| indexCount != ( count + CANDIDATE_INDEX_STRIDE - 1 ) / CANDIDATE_INDEX_STRIDE ) return Fail( path + ": bad index" );
+	for ( uint64_t b = 0; b < indexCount; b++ ) {
+		uint64_t at = Offset( b );
+		if ( at < CANDIDATE_HEADER_SIZE || at >= indexOffset ) return Fail( path + ": bad index" );
+	}
+	return true;
+}
+
+inline void CandidateReader::Close() {
+	if ( data ) munmap( (void *)data, length );
+	if ( fd >= 0 ) close( fd );
+	data = NULL;
+	fd = -1;
+}
+
+// Decode the records [first, first + n) into out
+inline bool CandidateReader::Read( uint64_t first, uint64_t n, std::vector<BigInt> &out ) {
+	if ( first + n > count ) return Fail( "read past the last record" );
+	out.resize( n );
+	uint64_t at = Offset( first / CANDIDATE_INDEX_STRIDE );
+	for ( uint64_t i = first - first % CANDIDATE_INDEX_STRIDE; i < first + n; i++ ) {
+		if ( indexOffset - at < 4 ) return Fail( "truncated record" );
+		uint64_t words = LoadLE( data + at, 4 );
+		if ( words > CANDIDATE_MAX_WORDS || ( indexOffset - at - 4 ) / 8 < words ) return Fail( "truncated record" );
+		if ( i >= first ) out[i-first] = BigIntFromWords( data + at + 4, words );
+		at += 4 + 8 * words;
+	}
+	return true;
+}
+
+// Drop the mapped pages of the records [first, first + n) once they are decoded,
+// so that the resident memory stays at a block whatever the file size
+inline void CandidateReader::Release( uint64_t first, uint64_t n ) {
+	uint64_t page = sysconf( _SC_PAGESIZE );
+	uint64_t from = Offset( first / CANDIDATE_INDEX_STRIDE );
+	uint64_t last = first + n;
+	uint64_t to = ( last < count && last % CANDIDATE_INDEX_STRIDE == 0 )?Offset( last / CANDIDATE_INDEX_STRIDE ):indexOffset;
+	from -= from % page;
+	to -= to % page;
+	if ( to > from ) madvise( (void *)( data + from ), to - from, MADV_DONTNEED );
+}
+
+// Verdict bitmap written block by block
+struct VerdictWriter {
+	FILE *file;
+	std::string error;
+
+	VerdictWriter():file(NULL) {};
+	~VerdictWriter() { if ( file ) fclose( file ); };
+
+	bool Open( const std::string &path, uint64_t count );
+	bool Write( const std::vector<uint64_t> &bitmap );
+	bool Close();
+	bool Fail( const std::string &what ) { error = what; return false; };
+};
+
+inline bool VerdictWriter::Open( const std::string &path, uint64_t count ) {
+	file = fopen( path.c_str(), "wb" );
+	if ( file == NULL ) return Fail( "cannot create " + path );
+	uint8_t head[16];
+	memcpy( head, VERDICT_MAGIC, 8 );
+	StoreLE( head + 8, count, 8 );
+	if ( fwrite( head, 1, sizeof( head ), file ) != sizeof( head ) ) return Fail( "write error on " + path );
+	return true;
+}
+
+inline bool VerdictWriter::Write( const std::vector<uint64_t> &bitmap ) {
+	std::vector<uint8_t> buf( 8 * bitmap.size() );
+	for ( size_t i = 0; i < bitmap.size(); i++ ) StoreLE( buf.data() + 8 * i, bitmap[i], 8 );
+	if ( fwrite( buf.data(), 1, buf.size(), file ) != buf.size() ) return Fail( "write error" );
+	return true;
+}
+
+inline bool VerdictWriter::Close() {
+	bool ok = ( fclose( file ) == 0 );
+	file = NULL;
+	return ok || Fail( "write error" );
+}
+
+// Value of a decimal or 0x prefixed hexadecimal line, false for anything else
+inline bool ParseCandidate( const std::string &line, BigInt &n ) {
+	if ( line.size() > 2 && line[0] == '0' && ( line[1] == 'x' || line[1] == 'X' ) ) {
+		// 16 hex digits per word from the end
+		SizeType digits = line.size() - 2;
+		std::vector<uint8_t> bytes( 8 * ( ( digits + 15 ) / 16 ), 0 );
+		for ( SizeType i = 0; i < digits; i++ ) {
+			char c = line[line.size()-1-i];
+			int v;
+			if ( c >= '0' && c <= '9' ) v = c - '0';
+			else if ( c >= 'a' && c <= 'f' ) v = c - 'a' + 10;
+			else if ( c >= 'A' && c <= 'F' ) v = c - 'A' + 10;
+			else return false;
+			bytes[i/2] |= (uint8_t)( v << ( 4 * ( i % 2 ) ) );
+		}
+		n = BigIntFromWords( bytes.data(), bytes.size() / 8 );
+		return true;
+	}
+	if ( line.empty() ) return false;
+	for ( size_t i = 0; i < line.size(); i++ ) {
+		if ( line[i] < '0' || line[i] > '9' ) return false;
+	}
+	n = BigInt( line );
+	return true;
+}
+
+// Text to binary: one decimal or 0x hexadecimal candidate per line, blank
+// lines and lines starting with # are skipped
+inline bool ConvertCandidates( std::istream &in, const std::string &path, uint64_t &count, std::string &error ) {
+	CandidateWriter writer;
+	if ( !writer.Open( path ) ) {
+		error = writer.error;
+		return false;
+	}
+	std::string line;
+	uint64_t lineno = 0;
+	BigInt n;
+	while ( std::getline( in, line ) ) {
+		lineno++;
+		size_t b = line.find_first_not_of( " \t\r" ), e = line.find_last_not_of( " \t\r" );
+		if ( b == std::string::npos || line[b] == '#' ) continue;
+		if ( !ParseCandidate( line.substr( b, e + 1 - b ), n ) ) {
+			error = "line " + std::to_string( lineno ) + ": not a decimal or 0x hexadecimal number";
+			return false;
+		}
+		if ( !writer.Append( n ) ) {
+			error = "line " + std::to_string( lineno ) + ": " + writer.error;
+			return false;
+		}
+	}
+	count = writer.count;
+	if ( !writer.Close() ) {
+		error = writer.error;
+		return false;
+	}
+	return true;
+}
+
+// Test every candidate of a file with the batch test, one index block at a
+// time, and write the verdict bitmap; primes counts the probable primes
+inline bool StreamCandidates( const std::string &inPath, const std::string &outPath, PrimeTestMode mode, DatType s,
+	ThreadPool *pool, uint64_t &primes, std::string &error ) {
+	CandidateReader reader;
+	VerdictWriter writer;
+	if ( !reader.Open( inPath ) ) {
+		error = reader.error;
+		return false;
+	}
+	if ( !writer.Open( outPath, reader.count ) ) {
+		error = writer.error;
+		return false;
+	}
+	primes = 0;
+	std::vector<BigInt> block;
+	for ( uint64_t first = 0; first < reader.count; first += CANDIDATE_INDEX_STRIDE ) {
+		uint64_t n = std::min( CANDIDATE_INDEX_STRIDE, reader.count - first );
+		if ( !reader.Read( first, n, block ) ) {
+			error = inPath + ": " + reader.error;
+			return false;
+		}
+		reader.Release( first, n );
+		std::vector<uint64_t> bitmap = ProbablePrimeBatch<BigInt>( block.data(), n, mode, s, pool );
+		for ( size_t i = 0; i < bitmap.size(); i++ ) primes += __builtin_popcountll( bitmap[i] );
+		if ( !writer.Write( bitmap ) ) {
+			error = writer.error;
+			return false;
+		}
+	}
+	if ( !writer.Close() ) {
+		error = writer.error;
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*************************************************************************
+*
+* Header file Checkpoint.h
+*	checkpoints of long jobs: the state is serialized to little endian
+*	words, written to a temporary file and renamed over the previous
+*	checkpoint, so that the file always holds one complete state
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "BigInt.h"
+#include "SolovayStrassen.h"
+
+// File: magic "SSCKPT01", payload length u64, payload, FNV-1a hash u64 of the payload
+const char CHECKPOINT_MAGIC[] = "SSCKPT01";
+const int CHECKPOINT_EXIT = 75;			// exit status of a stopped job ( EX_TEMPFAIL, run again )
+const time_t CHECKPOINT_INTERVAL = 60;		// default seconds between checkpoints
+
+// Set by SIGTERM / SIGINT once InstallCheckpointSignals was called
+inline std::atomic<bool> &CheckpointStop() {
+	static std::atomic<bool> stop( false );
+	return stop;
+}
+
+static void CheckpointSignal( int ) {
+	CheckpointStop() = true;
+}
+
+inline void InstallCheckpointSignals() {
+	CheckpointStop();		// the flag is created here, not in the handler
+	signal( SIGTERM, CheckpointSignal );
+	signal( SIGINT, CheckpointSignal );
+}
+
+static inline uint64_t Fnv1a( const uint8_t *p, SizeType n ) {
+	uint64_t h = 14695981039346656037ULL;
+	for ( SizeType i = 0; i < n; i++ ) h = ( h ^ p[i] ) * 1099511628211ULL;
+	return h;
+}
+
+// Payload written and read back field by field in the same order
+struct CheckpointData {
+	std::vector<uint8_t> bytes;
+	SizeType at;			// read position
+
+	CheckpointData():at(0) {};
+
+	void PutWord( uint64_t v );
+	void PutString( const std::string &s );
+	void PutBigInt( const BigInt &n );
+	bool GetWord( uint64_t &v );
+	bool GetString( std::string &s );
+	bool GetBigInt( BigInt &n );
+};
+
+inline void CheckpointData::PutWord( uint64_t v ) {
+	SizeType k = bytes.size();
+	bytes.resize( k + 8 );
+	StoreLE( bytes.data() + k, v, 8 );
+}
+
+inline void CheckpointData::PutString( const std::string &s ) {
+	PutWord( s.size() );
+	bytes.insert( bytes.end(), s.begin(), s.end() );
+}
+
+// sign word, word count, magnitude words
+inline void CheckpointData::PutBigInt( const BigInt &n ) {
+	std::vector<uint64_t> words;
+	BigIntToWords( n, words );
+	PutWord( (uint64_t)(int64_t)n.sign );
+	PutWord( words.size() );
+	for ( size_t i = 0; i < words.size(); i++ ) PutWord( words[i] );
+}
+
+inline bool CheckpointData::GetWord( uint64_t &v ) {
+	if ( (SizeType)bytes.size() - at < 8 ) return false;
+	v = LoadLE( bytes.data() + at, 8 );
+	at += 8;
+	return true;
+}
+
+inline bool CheckpointData::GetString( std::string &s ) {
+	uint64_t len;
+	if ( !GetWord( len ) || len > (uint64_t)( bytes.size() - at ) ) return false;
+	s.assign( bytes.begin() + at, bytes.begin() + at + len );
+	at += len;
+	return true;
+}
+
+inline bool CheckpointData::GetBigInt( BigInt &n ) {
+	uint64_t sign, count;
+	if ( !GetWord( sign ) || !GetWord( count ) || count > (uint64_t)( bytes.size() - at ) / 8 ) return false;
+	n = BigIntFromWords( bytes.data() + at, count );
+	if ( (int64_t)sign < 0 ) n = -n;
+	at += 8 * count;
+	return true;
+}
+
+// Checkpoint file of a job: Due() paces the saves, Save() replaces the file
+// atomically, Load() accepts only a complete file with a matching hash
+struct CheckpointFile {
+	std::string path;
+	time_t interval;
+	std::atomic<time_t> last;	// time of the last save that was due, shared by the threads of the job
+	std::mutex lock;		// one writer at a time
+	std::string error;
+
+	CheckpointFile( const std::string &p, time_t seconds = CHECKPOINT_INTERVAL ):path(p),interval(seconds),last( time( NULL ) ) {};
+
+	bool Due();
+	bool Save( const CheckpointData &data );
+	int Load( CheckpointData &data );
+	void Remove() { unlink( path.c_str() ); };
+	void Stop();
+	bool Fail( const std::string &what ) { error = what; return false; };
+};
+
+// true when interval seconds passed since last or a stop was asked; of the
+// threads that find the interval passed only the one moving last to now saves
+inline bool CheckpointFile::Due() {
+	time_t now = time( NULL ), prev = last;
+	if ( CheckpointStop() ) return true;
+	if ( now - prev < interval ) return false;
+	return last.compare_exchange_strong( prev, now );
+}
+
+// Write to path.tmp, flush it to disk, then rename it over path
+inline bool CheckpointFile::Save( const CheckpointData &data ) {
+	std::string tmp = path + ".tmp";
+	std::vector<uint8_t> head( 16 ), tail( 8 );
+	memcpy( head.data(), CHECKPOINT_MAGIC, 8 );
+	StoreLE( head.data() + 8, data.bytes.size(), 8 );
+	StoreLE( tail.data(), Fnv1a( data.bytes.data(), data.bytes.size() ), 8 );
+
+	int fd = open( tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if ( fd < 0 ) return Fail( "cannot create " + tmp );
+	const std::vector<uint8_t> *parts[3] = { &head, &data.bytes, &tail };
+	bool ok = true;
+	for ( int k = 0; k < 3 && ok; k++ ) {
+		const uint8_t *p = parts[k]->data();
+		size_t left = parts[k]->size();
+		while ( ok && left > 0 ) {
+			ssize_t w = write( fd, p, left );
+			ok = ( w > 0 );
+			if ( ok ) {
+				p += w;
+				left -= w;
+			}
+		}
+	}
+	ok = ok && fsync( fd ) == 0;
+	ok = ( close( fd ) == 0 ) && ok;
+	if ( !ok || rename( tmp.c_str(), path.c_str() ) != 0 ) {
+		unlink( tmp.c_str() );
+		return Fail( "cannot write " + path );
+	}
+	return true;
+}
+
+// 1 with the payload in data, 0 without a checkpoint, -1 for a damaged file
+inline int CheckpointFile::Load( CheckpointData &data ) {
+	FILE *file = fopen( path.c_str(), "rb" );
+	if ( file == NULL ) return 0;
+	uint8_t head[16], tail[8];
+	bool ok = fread( head, 1, 16, file ) == 16 && memcmp( head, CHECKPOINT_MAGIC, 8 ) == 0;
+	uint64_t len = ok?LoadLE( head + 8, 8 ):0;
+	// the payload must fill the rest of the file
+	if ( ok && fseek( file, 0, SEEK_END ) == 0 ) ok = ( (uint64_t)ftell( file ) == len + 24 ) && fseek( file, 16, SEEK_SET ) == 0;
+	if ( ok ) {
+		data.bytes.resize( len );
+		data.at = 0;
+		ok = fread( data.bytes.data(), 1, len, file ) == len && fread( tail, 1, 8, file ) == 8
+			&& LoadLE( tail, 8 ) == Fnv1a( data.bytes.data(), len );
+	}
+	fclose( file );
+	if ( !ok ) {
+		error = path + " is not a valid checkpoint";
+		return -1;
+	}
+	return 1;
+}
+
+// Leave after a stop signal, the last Save holds the state to resume from
+// ( _exit: workers of a pool may still be inside an exponentiation )
+inline void CheckpointFile::Stop() {
+	std::cout << std::endl << "Stopped, resume from " << path << std::endl;
+	std::cout.flush();
+	_exit( CHECKPOINT_EXIT );
+}
+
+// Witness round of a resumable Solovay-Strassen test
+const uint64_t ROUND_PENDING = 0;
+const uint64_t ROUND_RUNNING = 1;
+const uint64_t ROUND_PASSED = 2;
+const uint64_t ROUND_FAILED = 3;
+
+struct RoundState {
+	uint64_t status;
+	BigInt a;		// witness, set from ROUND_RUNNING on
+	int64_t jac;		// (a/n)
+	SizeType bit;		// progress of a^((n-1)/2), see PowProgress
+	BigInt acc;
+
+	RoundState():status(ROUND_PENDING),jac(0),bit(-1) {};
+
+	void Put( CheckpointData &data ) const;
+	bool Get( CheckpointData &data );
+};
+
+inline void RoundState::Put( CheckpointData &data ) const {
+	data.PutWord( status );
+	data.PutBigInt( a );
+	data.PutWord( (uint64_t)jac );
+	data.PutWord( (uint64_t)(int64_t)bit );
+	data.PutBigInt( acc );
+}
+
+inline bool RoundState::Get( CheckpointData &data ) {
+	uint64_t j, b;
+	if ( !data.GetWord( status ) || !data.GetBigInt( a ) || !data.GetWord( j ) || !data.GetWord( b ) || !data.GetBigInt( acc ) ) return false;
+	jac = (int64_t)j;
+	bit = (SizeType)(int64_t)b;
+	return status <= ROUND_FAILED;
+}
+
+// Solovay-Strassen rounds on an odd n > 2 that survive a restart: rounds[j]
+// holds the witness of round j and the progress of its exponentiation, every
+// running round saves its state when file.Due() says so ( one of them per
+// interval ) and save() then writes the whole job ( called with file.lock held ).
+// A stop signal saves and exits.
+// With a pool the rounds run concurrently like RunRounds and leave their
+// exponentiation once a round proved n composite
+inline bool ResumableRounds( const BigInt &n, std::vector<RoundState> &rounds, ThreadPool *pool,
+	CheckpointFile &file, const std::function<void()> &save ) {
+	ModContext<BigInt> ctx( n );
+	BigInt e = ( n - 1 ) / 2;
+	std::atomic<bool> found( false );
+
+	auto round = [&]( DatType j ) {
+		RoundState &st = rounds[j];
+		{
+			std::lock_guard<std::mutex> guard( file.lock );
+			if ( st.status == ROUND_FAILED ) found = true;
+			if ( st.status != ROUND_PENDING && st.status != ROUND_RUNNING ) return;
+		}
+		if ( found ) return;
+		PowProgress progress;
+		if ( st.status == ROUND_PENDING ) {
+			BigInt a;
+			int jac;
+			WitnessScope scope( WitnessKey( n ), j );
+			do {
+				a = MakeRand<BigInt>( n - 1 ) + 1;
+				jac = Jacobi<BigInt>( a, n );
+			} while ( jac == 0 );
+			progress.Start( e );
+			std::lock_guard<std::mutex> guard( file.lock );
+			st.a = a;
+			st.jac = jac;
+			st.bit = progress.bit;
+			st.acc = progress.acc;
+			st.status = ROUND_RUNNING;
+		} else {
+			progress.bit = st.bit;
+			progress.acc = st.acc;
+		}
+		progress.due = [&]() { return file.Due(); };
+		progress.stop = &found;
+		progress.save = [&]( const PowProgress &p ) {
+			std::lock_guard<std::mutex> guard( file.lock );
+			st.bit = p.bit;
+			st.acc = p.acc;
+			save();
+			if ( CheckpointStop() ) file.Stop();
+		};
+		BigInt diff = ctx.Pow( st.a, e, &progress ) - BigInt( (DatType)st.jac );
+		bool pass = ( diff == 0 ) || ( diff == n );
+		std::lock_guard<std::mutex> guard( file.lock );
+		// stopped by another round's witness, the result is meaningless
+		if ( found ) return;
+		st.status = pass?ROUND_PASSED:ROUND_FAILED;
+		st.bit = -1;
+		st.acc = BigInt();
+		if ( !pass ) found = true;
+		save();
+	};
+
+	if ( pool && pool->Size() > 1 && rounds.size() > 1 ) pool->ParallelFor( rounds.size(), round );
+	else for ( size_t j = 0; j < rounds.size() && !found; j++ ) round( j );
+	return !found;
+}
+
+#endif
@@ -0,0 +1,482 @@
+/*************************************************************************
+*
+* Header file FixedInt.h
+*	fixed width unsigned integers FixedInt<Bits> with the limbs on the
+*	stack, for moduli of a known size ( 256, 512, ..., 4096 bits )
+*	and their Montgomery context
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef FIXEDINT_H
+#define FIXEDINT_H
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include "Limb.h"
+#include "BigInt.h"
+#include "Montgomery.h"
+#include "Random.h"
+
+// The loops over the limbs have a compile time trip count, unrolled in full
+#define FIXED_UNROLL _Pragma( "GCC unroll 64" )
+
+// Arithmetic is modulo 2^Bits like the built-in unsigned types, a DatType
+// is sign extended ( FixedInt( -1 ) = 2^Bits - 1 ) so that x - 1 and x + (-1)
+// agree. Bits must be a multiple of the limb width.
+template <int Bits>
+struct FixedInt {
+	static const int LIMBS = Bits / LIMB_BITS;
+	LimbType limb[LIMBS];	// least significant limb first
+	static_assert( Bits > 0 && Bits % 64 == 0, "FixedInt width must be a multiple of 64 bits" );
+
+	FixedInt() { std::fill( limb, limb + LIMBS, 0 ); };
+	FixedInt( DatType n );
+	explicit FixedInt( const BigInt &n );
+	explicit FixedInt( const std::string &s ):FixedInt( BigInt( s ) ) {};
+
+	BigInt ToBigInt() const;
+	std::string ToString() const { return ToBigInt().ToString(); };
+	SizeType BitLength() const;
+	bool TestBit( SizeType i ) const { return ( limb[i / LIMB_BITS] >> ( i % LIMB_BITS ) ) & 1; };
+	bool IsZero() const;
+
+	// Arithmetic
+	FixedInt &operator+=( const FixedInt &n );
+	FixedInt &operator-=( const FixedInt &n );
+	FixedInt &operator*=( const FixedInt &n );
+	FixedInt &operator/=( const FixedInt &n );
+	FixedInt &operator%=( const FixedInt &n );
+	FixedInt &operator/=( DatType n );
+	FixedInt operator+( const FixedInt &n ) const { FixedInt r( *this ); return r += n; };
+	FixedInt operator-( const FixedInt &n ) const { FixedInt r( *this ); return r -= n; };
+	FixedInt operator*( const FixedInt &n ) const { FixedInt r( *this ); return r *= n; };
+	FixedInt operator/( const FixedInt &n ) const { FixedInt r( *this ); return r /= n; };
+	FixedInt operator%( const FixedInt &n ) const { FixedInt r( *this ); return r %= n; };
+	FixedInt operator/( DatType n ) const { FixedInt r( *this ); return r /= n; };
+	FixedInt operator-() const { FixedInt r; return r -= *this; };
+
+	// Remainder by |n| as a word, powers of two only mask the low limb
+	DatType operator%( DatType n ) const;
+
+	FixedInt &operator<<=( int n );
+	FixedInt &operator>>=( int n );
+	FixedInt operator<<( int n ) const { FixedInt r( *this ); return r <<= n; };
+	FixedInt operator>>( int n ) const { FixedInt r( *this ); return r >>= n; };
+
+	// Comparision ( unsigned )
+	int Cmp( const FixedInt &n ) const { return LimbCmp( limb, n.limb, LIMBS ); };
+	bool operator==( const FixedInt &n ) const;
+	bool operator!=( const FixedInt &n ) const { return !operator==( n ); };
+	bool operator<( const FixedInt &n ) const { return Cmp( n ) < 0; };
+	bool operator>( const FixedInt &n ) const { return Cmp( n ) > 0; };
+	bool operator<=( const FixedInt &n ) const { return Cmp( n ) <= 0; };
+	bool operator>=( const FixedInt &n ) const { return Cmp( n ) >= 0; };
+
+	static void DivRem( const FixedInt &a, const FixedInt &b, FixedInt *q, FixedInt *r );
+};
+
+template <int Bits>
+FixedInt<Bits>::FixedInt( DatType n ) {
+	LimbType tmp[2];
+	uint64_t u = (uint64_t)n;
+	SizeType k = LimbFromU64( tmp, u );
+	LimbType ext = ( n < 0 )?LIMB_MAX:0;
+	std::fill( limb, limb + LIMBS, ext );
+	for ( SizeType i = 0; i < k; i++ ) limb[i] = tmp[i];
+}
+
+// The magnitude of n mod 2^Bits, negated for n < 0
+template <int Bits>
+FixedInt<Bits>::FixedInt( const BigInt &n ) {
+	std::fill( limb, limb + LIMBS, 0 );
+	SizeType k = std::min<SizeType>( n.size, LIMBS );
+	std::copy( n.limbs.begin(), n.limbs.begin() + k, limb );
+	if ( n.sign < 0 ) *this = -*this;
+}
+
+template <int Bits>
+BigInt FixedInt<Bits>::ToBigInt() const {
+	BigInt rs;
+	rs.limbs.assign( limb, limb + LIMBS );
+	rs.size = LIMBS;
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
+}
+
+template <int Bits>
+SizeType FixedInt<Bits>::BitLength() const {
+	SizeType n = LimbNormSize( limb, LIMBS );
+	if ( n == 0 ) return 0;
+	return n * LIMB_BITS - LimbClz( limb[n-1] );
+}
+
+template <int Bits>
+bool FixedInt<Bits>::IsZero() const {
+	LimbType acc = 0;
+	FIXED_UNROLL
+	for ( int i = 0; i < LIMBS; i++ ) acc |= limb[i];
+	return acc == 0;
+}
+
+template <int Bits>
+bool FixedInt<Bits>::operator==( const FixedInt &n ) const {
+	LimbType acc = 0;
+	FIXED_UNROLL
+	for ( int i = 0; i < LIMBS; i++ ) acc |= limb[i] ^ n.limb[i];
+	return acc == 0;
+}
+
+// Carry chains through the double limb type, no branch per limb
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator+=( const FixedInt &n ) {
+	LimbType carry = 0;
+	FIXED_UNROLL
+	for ( int i = 0; i < LIMBS; i++ ) {
+		DLimbType s = (DLimbType)limb[i] + n.limb[i] + carry;
+		limb[i] = (LimbType)s;
+		carry = (LimbType)( s >> LIMB_BITS );
+	}
+	return *this;
+}
+
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator-=( const FixedInt &n ) {
+	LimbType borrow = 0;
+	FIXED_UNROLL
+	for ( int i = 0; i < LIMBS; i++ ) {
+		DLimbType s = (DLimbType)limb[i] - n.limb[i] - borrow;
+		limb[i] = (LimbType)s;
+		borrow = (LimbType)( s >> LIMB_BITS ) & 1;
+	}
+	return *this;
+}
+
+// Low half of the product only
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator*=( const FixedInt &n ) {
+	LimbType r[LIMBS] = { 0 };
+	for ( int i = 0; i < LIMBS; i++ ) {
+		LimbType carry = 0;
+		for ( int j = 0; j < LIMBS - i; j++ ) {
+			DLimbType t = (DLimbType)limb[i] * n.limb[j] + r[i+j] + carry;
+			r[i+j] = (LimbType)t;
+			carry = (LimbType)( t >> LIMB_BITS );
+		}
+	}
+	std::copy( r, r + LIMBS, limb );
+	return *this;
+}
+
+// q = a / b, r = a % b ( q or r may be NULL ), Knuth D on the stack
+template <int Bits>
+void FixedInt<Bits>::DivRem( const FixedInt &a, const FixedInt &b, FixedInt *q, FixedInt *r ) {
+	SizeType an = LimbNormSize( a.limb, LIMBS ), bn = LimbNormSize( b.limb, LIMBS );
+	if ( bn == 0 ) bn /= bn;
+	FixedInt quo, rem;
+	if ( LimbCmp( a.limb, an, b.limb, bn ) < 0 ) {
+		rem = a;
+	} else if ( an == bn && ( a.limb[an-1] >> 3 ) < b.limb[bn-1] ) {
+		// quotient below 16, the common case of the Euclidean steps
+		rem = a;
+		while ( LimbCmp( rem.limb, b.limb, bn ) >= 0 ) {
+			LimbSubN( rem.limb, rem.limb, b.limb, bn );
+			quo.limb[0]++;
+		}
+	} else if ( bn == 1 ) {
+		rem.limb[0] = LimbDivMod1( quo.limb, a.limb, an, b.limb[0] );
+	} else {
+		LimbType ws[2 * LIMBS + 1];
+		LimbDivRem( quo.limb, rem.limb, a.limb, an, b.limb, bn, ws );
+	}
+	if ( q ) *q = quo;
+	if ( r ) *r = rem;
+}
+
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator/=( const FixedInt &n ) {
+	DivRem( *this, n, this, NULL );
+	return *this;
+}
+
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator%=( const FixedInt &n ) {
+	DivRem( *this, n, NULL, this );
+	return *this;
+}
+
+// Division by |n|, a shift for powers of two
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator/=( DatType n ) {
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	if ( mag != 0 && ( mag & ( mag - 1 ) ) == 0 ) return operator>>=( __builtin_ctzll( mag ) );
+	if ( mag > LIMB_MAX ) return operator/=( FixedInt( (DatType)mag ) );
+	if ( mag == 0 ) mag /= mag;
+	LimbDivMod1( limb, limb, LIMBS, (LimbType)mag );
+	return *this;
+}
+
+template <int Bits>
+DatType FixedInt<Bits>::operator%( DatType n ) const {
+	uint64_t mag = ( n < 0 )?( 0 - (uint64_t)n ):(uint64_t)n;
+	if ( mag != 0 && ( mag & ( mag - 1 ) ) == 0 && mag <= LIMB_MAX ) return (DatType)( limb[0] & (LimbType)( mag - 1 ) );
+	if ( mag > LIMB_MAX ) {
+		FixedInt r = *this % FixedInt( (DatType)mag );
+		uint64_t numb = 0;
+		for ( int i = std::min( LIMBS, 64 / LIMB_BITS ) - 1; i >= 0; i-- ) numb = ( numb << ( LIMB_BITS % 64 ) ) | r.limb[i];
+		return (DatType)numb;
+	}
+	if ( mag == 0 ) mag /= mag;
+	return (DatType)LimbMod1( limb, LIMBS, (LimbType)mag );
+}
+
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator<<=( int n ) {
+	if ( n <= 0 ) return ( n < 0 )?operator>>=( -n ):*this;
+	if ( n >= Bits ) return *this = FixedInt();
+	int ls = n / LIMB_BITS, bs = n % LIMB_BITS;
+	if ( ls ) {
+		for ( int i = LIMBS - 1; i >= ls; i-- ) limb[i] = limb[i-ls];
+		std::fill( limb, limb + ls, 0 );
+	}
+	if ( bs ) LimbLshift( limb, limb, LIMBS, bs );
+	return *this;
+}
+
+template <int Bits>
+FixedInt<Bits> &FixedInt<Bits>::operator>>=( int n ) {
+	if ( n <= 0 ) return ( n < 0 )?operator<<=( -n ):*this;
+	if ( n >= Bits ) return *this = FixedInt();
+	int ls = n / LIMB_BITS, bs = n % LIMB_BITS;
+	if ( ls ) {
+		for ( int i = 0; i + ls < LIMBS; i++ ) limb[i] = limb[i+ls];
+		std::fill( limb + LIMBS - ls, limb + LIMBS, 0 );
+	}
+	if ( bs ) LimbRshift( limb, limb, LIMBS, bs );
+	return *this;
+}
+
+template <int Bits>
+std::ostream &operator<<( std::ostream &out, const FixedInt<Bits> &n ) {
+	return out << n.ToString();
+}
+
+// Uniform in [0, m) for m != 0, rejection on the top limb like RandBigIntBelow
+template <int Bits>
+FixedInt<Bits> RandBelow( const FixedInt<Bits> &m ) {
+	WitnessRng &rng = ThreadRng();
+	SizeType n = LimbNormSize( m.limb, FixedInt<Bits>::LIMBS );
+	LimbType mtop = m.limb[n-1];
+	LimbType mask = LIMB_MAX >> LimbClz( mtop );
+	FixedInt<Bits> rs;
+	while ( true ) {
+		LimbType top;
+		rng.Fill( &top, 1 );
+		top &= mask;
+		if ( top > mtop ) continue;
+		rs.limb[n-1] = top;
+		rng.Fill( rs.limb, n - 1 );
+		if ( top < mtop || LimbCmp( rs.limb, m.limb, n ) < 0 ) break;
+	}
+	return rs;
+}
+
+// a * b mod m through the full double width product, for any m != 0
+template <int Bits>
+FixedInt<Bits> MulMod( const FixedInt<Bits> &a, const FixedInt<Bits> &b, const FixedInt<Bits> &m ) {
+	const int N = FixedInt<Bits>::LIMBS;
+	LimbType p[2 * N], ws[3 * N + 1];
+	LimbMulBasecase( p, a.limb, N, b.limb, N );
+	SizeType pn = LimbNormSize( p, 2 * N ), mn = LimbNormSize( m.limb, N );
+	FixedInt<Bits> r;
+	if ( mn == 0 ) mn /= mn;
+	if ( LimbCmp( p, pn, m.limb, mn ) < 0 ) std::copy( p, p + pn, r.limb );
+	else if ( mn == 1 ) r.limb[0] = LimbMod1( p, pn, m.limb[0] );
+	else {
+		LimbType qq[2 * N];
+		LimbDivRem( qq, r.limb, p, pn, m.limb, mn, ws );
+	}
+	return r;
+}
+
+// r = a * b for N-limb operands, LimbMulKaratsuba with its scratch on the
+// stack ( the halves are fixed at compile time ) down to the basecase
+template <int N, bool Split = ( N >= MUL_KARATSUBA_THRESHOLD )>
+struct FixedMul {
+	static void Run( LimbType *r, const LimbType *a, const LimbType *b ) { LimbMulBasecase( r, a, N, b, N ); };
+};
+
+template <int N>
+struct FixedMul<N, true> {
+	static const int H = ( N + 1 ) / 2, L = N - H;
+
+	static void Run( LimbType *r, const LimbType *a, const LimbType *b ) {
+		LimbType da[H], db[H], z1[2*H], mid[2*H+1];
+		int neg = LimbAbsDiff( da, a, H, a + H, L ) ^ LimbAbsDiff( db, b, H, b + H, L );
+		FixedMul<H>::Run( z1, da, db );
+		FixedMul<H>::Run( r, a, b );
+		FixedMul<L>::Run( r + 2 * H, a + H, b + H );
+		mid[2*H] = LimbAdd( mid, r, 2 * H, r + 2 * H, 2 * L );
+		if ( neg ) mid[2*H] += LimbAddN( mid, mid, z1, 2 * H );
+		else mid[2*H] -= LimbSubN( mid, mid, z1, 2 * H );
+		LimbAdd( r + H, r + H, 2 * N - H, mid, 2 * H + 1 );
+	};
+};
+
+// r = a^2 for an N-limb operand, as FixedMul
+template <int N, bool Split = ( N >= SQR_KARATSUBA_THRESHOLD )>
+struct FixedSqr {
+	static void Run( LimbType *r, const LimbType *a ) { LimbSqrBasecase( r, a, N ); };
+};
+
+template <int N>
+struct FixedSqr<N, true> {
+	static const int H = ( N + 1 ) / 2, L = N - H;
+
+	static void Run( LimbType *r, const LimbType *a ) {
+		LimbType da[H], z1[2*H], mid[2*H+1];
+		LimbAbsDiff( da, a, H, a + H, L );
+		FixedSqr<H>::Run( z1, da );
+		FixedSqr<H>::Run( r, a );
+		FixedSqr<L>::Run( r + 2 * H, a + H );
+		mid[2*H] = LimbAdd( mid, r, 2 * H, r + 2 * H, 2 * L );
+		mid[2*H] -= LimbSubN( mid, mid, z1, 2 * H );
+		LimbAdd( r + H, r + H, 2 * N - H, mid, 2 * H + 1 );
+	};
+};
+
+// Montgomery residues x*R mod m with R = 2^Bits, for an odd modulus below 2^Bits
+// ( odd = false leaves the context unprepared )
+template <int Bits>
+struct FixedMontgomery {
+	typedef FixedInt<Bits> Int;
+	static const int N = Int::LIMBS;
+	Int m;
+	LimbType minv;		// -m^(-1) mod 2^LIMB_BITS
+	Int r2;			// R^2 mod m
+	Int one;		// R mod m
+	bool odd;
+
+	FixedMontgomery( const Int &mod );
+
+	void Redc( Int &r, LimbType *t ) const;
+	void Mul( Int &r, const Int &a, const Int &b ) const;
+	void Sqr( Int &r, const Int &a ) const;
+	Int Convert( const Int &a ) const;
+	Int Revert( const Int &a ) const;
+	Int Pow( const Int &b, const Int &e ) const;
+};
+
+template <int Bits>
+FixedMontgomery<Bits>::FixedMontgomery( const Int &mod ):m(mod),minv(0),odd( ( mod.limb[0] & 1 ) != 0 ) {
+	if ( !odd ) return;
+	minv = 0 - LimbInverse( m.limb[0] );
+	BigInt mb = m.ToBigInt();
+	one = Int( ( BigInt( 1 ) << Bits ) % mb );
+	r2 = Int( ( BigInt( 1 ) << ( 2 * Bits ) ) % mb );
+}
+
+// r = t * R^(-1) mod m for t < m*R of 2N limbs ( t is destroyed ), the final
+// subtraction is done by a mask
+template <int Bits>
+void FixedMontgomery<Bits>::Redc( Int &r, LimbType *t ) const {
+	FIXED_UNROLL
+	for ( int i = 0; i < N; i++ ) {
+		LimbType q = t[i] * minv;
+		// t[i] becomes zero, keep the carry there and add it at position i+N later
+		t[i] = LimbAddMul1( t + i, m.limb, N, q );
+	}
+	LimbType u[N], carry = 0, borrow = 0;
+	FIXED_UNROLL
+	for ( int j = 0; j < N; j++ ) {
+		DLimbType s = (DLimbType)t[N+j] + t[j] + carry;
+		t[j] = (LimbType)s;
+		carry = (LimbType)( s >> LIMB_BITS );
+	}
+	// t < 2m: keep t - m unless it borrows out of the carry
+	FIXED_UNROLL
+	for ( int j = 0; j < N; j++ ) {
+		DLimbType s = (DLimbType)t[j] - m.limb[j] - borrow;
+		u[j] = (LimbType)s;
+		borrow = (LimbType)( s >> LIMB_BITS ) & 1;
+	}
+	LimbType keep = 0 - (LimbType)( carry < borrow );
+	FIXED_UNROLL
+	for ( int j = 0; j < N; j++ ) r.limb[j] = ( t[j] & keep ) | ( u[j] & ~keep );
+}
+
+// r = a * b * R^(-1) mod m for a, b < m, r may alias a or b
+template <int Bits>
+void FixedMontgomery<Bits>::Mul( Int &r, const Int &a, const Int &b ) const {
+	LimbType t[2*N];
+	FixedMul<N>::Run( t, a.limb, b.limb );
+	Redc( r, t );
+}
+
+// r = a^2 * R^(-1) mod m, about half the limb products of Mul
+template <int Bits>
+void FixedMontgomery<Bits>::Sqr( Int &r, const Int &a ) const {
+	LimbType t[2*N];
+	FixedSqr<N>::Run( t, a.limb );
+	Redc( r, t );
+}
+
+template <int Bits>
+FixedInt<Bits> FixedMontgomery<Bits>::Convert( const Int &a ) const {
+	Int x = ( a < m )?a:a % m, r;
+	Mul( r, x, r2 );
+	return r;
+}
+
+template <int Bits>
+FixedInt<Bits> FixedMontgomery<Bits>::Revert( const Int &a ) const {
+	Int r;
+	Mul( r, a, Int( 1 ) );
+	return r;
+}
+
+// Return b^e mod m, left-to-right sliding window as in WindowPow, the table
+// of odd powers lives on the stack
+template <int Bits>
+FixedInt<Bits> FixedMontgomery<Bits>::Pow( const Int &b, const Int &e ) const {
+	SizeType bits = e.BitLength();
+	if ( bits == 0 ) return Int( 1 );
+	int k = WindowWidth( bits );
+	int tsz = 1 << ( k - 1 );
+	Int table[64], b2, acc;
+	table[0] = Convert( b );
+	if ( tsz > 1 ) {
+		Sqr( b2, table[0] );
+		for ( int j = 1; j < tsz; j++ ) Mul( table[j], table[j-1], b2 );
+	}
+
+	bool first = true;
+	SizeType i = bits - 1;
+	while ( i >= 0 ) {
+		if ( !e.TestBit( i ) ) {
+			Sqr( acc, acc );
+			i--;
+			continue;
+		}
+		// longest window of at most k bits ending in a set bit
+		SizeType l = std::max<SizeType>( i - k + 1, 0 );
+		while ( !e.TestBit( l ) ) l++;
+		int w = 0;
+		for ( SizeType j = i; j >= l; j-- ) w = 2 * w + e.TestBit( j );
+		if ( first ) {
+			acc = table[w >> 1];
+			first = false;
+		} else {
+			for ( SizeType j = l; j <= i; j++ ) Sqr( acc, acc );
+			Mul( acc, acc, table[w >> 1] );
+		}
+		i = l - 1;
+	}
+	return Revert( acc );
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*************************************************************************
+*
+* Header file Gcd.h
+*	gcd and Jacobi symbol kernels for BigInt
+*	Lehmer multi-word Euclid steps for large operands,
+*	binary ( shift and subtract ) algorithms on single words
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef GCD_H
+#define GCD_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "BigInt.h"
+
+// Bits of the leading digits used by a Lehmer step, leaves room for the
+// signed cofactors in DatType and keeps them below one limb
+const int LEHMER_BITS = LIMB_BITS - 3;
+
+// Binary gcd of two words ( limbs or long long magnitudes )
+static inline uint64_t GcdWord( uint64_t a, uint64_t b ) {
+	if ( a == 0 ) return b;
+	if ( b == 0 ) return a;
+	int k = __builtin_ctzll( a | b );
+	a >>= __builtin_ctzll( a );
+	do {
+		b >>= __builtin_ctzll( b );
+		if ( a > b ) {
+			uint64_t t = a;
+			a = b;
+			b = t;
+		}
+		b -= a;
+	} while ( b != 0 );
+	return a << k;
+}
+
+// Binary Jacobi symbol (a/n) of two words, n odd
+// Branch free steps: the sign is kept in bit 0 of j, a < n swaps by masks
+static inline int JacobiWord( uint64_t a, uint64_t n ) {
+	uint64_t j = 0;
+	while ( a != 0 ) {
+		int z = __builtin_ctzll( a );
+		a >>= z;
+		// (2/n) = -1 for n = 3, 5 mod 8
+		j ^= z & ( ( n >> 1 ) ^ ( n >> 2 ) );
+		// a < n: (a/n) = (n/a) unless a = n = 3 mod 4, then swap
+		uint64_t lt = 0 - (uint64_t)( a < n );
+		j ^= lt & ( ( a & n ) >> 1 );
+		uint64_t d = a - n;
+		n += d & lt;
+		a = ( d ^ lt ) - lt;
+	}
+	if ( n != 1 ) return 0;
+	return ( j & 1 )?-1:1;
+}
+
+// Jacobi symbol tracked along a Euclidean remainder sequence u >= v,
+// ( u, v ) <- ( v, u - q v ), using only the values mod 8 and q mod 8
+// Invariant: (a/b) = sign * ( num / den ) where den is odd and is u or v
+struct JacobiState {
+	int sign;
+	bool denIsU;
+	unsigned u8, v8;
+
+	// (2/x) and the reciprocity sign for odd residues mod 8
+	static int Two( unsigned x ) { return ( x == 3 || x == 5 )?-1:1; };
+	static int Eps( unsigned x, unsigned y ) { return ( ( x & 3 ) == 3 && ( y & 3 ) == 3 )?-1:1; };
+
+	void Step( unsigned q8 ) {
+		unsigned r8 = ( u8 - q8 * v8 ) & 7;
+		if ( denIsU ) {
+			if ( v8 & 1 ) {
+				// (v/u) = eps (u/v) = eps (r/v), v is the new denominator
+				sign *= Eps( v8, u8 );
+			} else {
+				// v = 2^k v', (v/u) = (v/r) except for k = 1 where the
+				// factors (2/u)(2/r) and the reciprocity signs of v' remain
+				if ( ( v8 & 3 ) == 2 ) {
+					unsigned h = ( v8 >> 1 ) & 3;
+					sign *= Two( u8 ) * Two( r8 ) * Eps( h, u8 ) * Eps( h, r8 );
+				}
+				denIsU = false;
+				u8 = v8;
+				v8 = r8;
+				return;
+			}
+		}
+		// the denominator moves from v to u
+		denIsU = true;
+		u8 = v8;
+		v8 = r8;
+	};
+};
+
+// r = A u + B v for signed cofactors below one limb, the result is known to be
+// non-negative, u and v have n limbs, r has n + 2 limbs
+static void LehmerCombine( LimbType *r, const LimbType *u, DatType A, const LimbType *v, DatType B,
+		SizeType n, LimbType *t ) {
+	LimbType a = (LimbType)( ( A < 0 )?-A:A ), b = (LimbType)( ( B < 0 )?-B:B );
+	r[n] = LimbMul1( r, u, n, a );
+	r[n+1] = 0;
+	t[n] = LimbMul1( t, v, n, b );
+	t[n+1] = 0;
+	if ( A >= 0 && B >= 0 ) LimbAddN( r, r, t, n + 2 );
+	else if ( A >= 0 ) LimbSubN( r, r, t, n + 2 );
+	else LimbSubN( r, t, r, n + 2 );
+}
+
+// Euclid on u >= v >= 0 until u fits in one limb or v is zero
+// Lehmer steps: quotients computed from the leading LEHMER_BITS of u and v are
+// collected into a cofactor matrix while they are provably exact, then the
+// matrix is applied to the full numbers in one pass; a full division step is
+// taken when the leading digits do not determine any quotient
+static void LehmerEuclid( BigInt &u, BigInt &v, JacobiState *js ) {
+	LimbVector r1, r2, t;
+	BigInt q, rm;
+	while ( u.size > 1 && v.size > 0 ) {
+		DatType A = 1, B = 0, C = 0, D = 1;
+		if ( v.size > 1 ) {
+			SizeType shift = u.BitLength() - LEHMER_BITS;
+			DatType uh = (DatType)u.GetBits( shift, LEHMER_BITS );
+			DatType vh = (DatType)v.GetBits( shift, LEHMER_BITS );
+			while ( vh + C > 0 && vh + D > 0 ) {
+				DatType qh = ( uh + A ) / ( vh + C );
+				if ( qh != ( uh + B ) / ( vh + D ) ) break;
+				DatType T = A - qh * C;
+				A = C;
+				C = T;
+				T = B - qh * D;
+				B = D;
+				D = T;
+				T = uh - qh * vh;
+				uh = vh;
+				vh = T;
+				if ( js ) js->Step( (unsigned)( qh & 7 ) );
+			}
+		}
+
+		if ( B == 0 ) {
+			// full step u, v = v, u mod v
+			u.DivMod( v, q, rm );
+			if ( js ) js->Step( (unsigned)( q.limbs[0] & 7 ) );
+			u = v;
+			v = rm;
+			continue;
+		}
+
+		SizeType n = u.size;
+		r1.assign( n + 2, 0 );
+		r2.assign( n + 2, 0 );
+		t.assign( n + 2, 0 );
+		v.limbs.resize( n, 0 );
+		LehmerCombine( r1.data(), u.limbs.data(), A, v.limbs.data(), B, n, t.data() );
+		LehmerCombine( r2.data(), u.limbs.data(), C, v.limbs.data(), D, n, t.data() );
+		u.limbs.swap( r1 );
+		v.limbs.swap( r2 );
+		u.sign = v.sign = 1;
+		u.Normalize();
+		v.Normalize();
+	}
+}
+
+// Greatest common divisor of |a| and |b|
+inline BigInt BigGcd( BigInt a, BigInt b ) {
+	if ( a.sign != 0 ) a.sign = 1;
+	if ( b.sign != 0 ) b.sign = 1;
+	if ( a.CmpAbs( b ) < 0 ) std::swap( a, b );
+	LehmerEuclid( a, b, NULL );
+	if ( b.sign == 0 ) return a;
+	BigInt rs;
+	rs.limbs.assign( 1, (LimbType)GcdWord( a.limbs[0], b.limbs[0] ) );
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
+}
+
+// Jacobi symbol (a/b) for an odd b > 0
+inline int BigJacobi( BigInt a, BigInt b ) {
+	JacobiState js;
+	js.sign = 1;
+	if ( a.sign < 0 ) {
+		a.sign = 1;
+		if ( ( b.limbs[0] & 3 ) == 3 ) js.sign = -1;
+	}
+	js.denIsU = ( a.CmpAbs( b ) < 0 );
+	if ( js.denIsU ) std::swap( a, b );
+	js.u8 = ( a.size > 0 )?( a.limbs[0] & 7 ):0;
+	js.v8 = ( b.size > 0 )?( b.limbs[0] & 7 ):0;
+
+	LehmerEuclid( a, b, &js );
+	if ( b.sign == 0 ) return ( a == 1 )?js.sign:0;
+	LimbType u = a.limbs[0], v = b.limbs[0];
+	return js.denIsU?js.sign * JacobiWord( v, u ):js.sign * JacobiWord( u, v );
+}
+
+#endif
@@ -0,0 +1,310 @@
+/*************************************************************************
+*
+* Header file Limb.h
+*	low level kernels on little-endian limb arrays used by BigInt
+*	( least significant limb first, lengths counted in limbs )
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef LIMB_H
+#define LIMB_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef long long int DatType;
+typedef long SizeType;
+
+// Word backend: 64-bit limbs by default, build with -DBIGINT_LIMB32 for
+// 32-bit limbs on targets without a native 128-bit product
+#ifdef BIGINT_LIMB32
+typedef uint32_t LimbType;
+typedef uint64_t DLimbType;
+const int LIMB_DIGITS = 9;				// decimal digits per limb at the I/O boundary
+const LimbType LIMB_DECBASE = 1000000000u;		// 10^LIMB_DIGITS
+#else
+typedef uint64_t LimbType;
+typedef unsigned __int128 DLimbType;
+const int LIMB_DIGITS = 19;
+const LimbType LIMB_DECBASE = 10000000000000000000ull;
+#endif
+const int LIMB_BITS = sizeof( LimbType ) * 8;
+const LimbType LIMB_MAX = ~(LimbType)0;
+
+// Number of used limbs of a ( high zero limbs stripped )
+static inline SizeType LimbNormSize( const LimbType *a, SizeType n ) {
+	while ( n > 0 && a[n-1] == 0 ) n--;
+	return n;
+}
+
+// Compare two arrays of the same length
+static inline int LimbCmp( const LimbType *a, const LimbType *b, SizeType n ) {
+	for ( SizeType i = n - 1; i >= 0; i-- ) {
+		if ( a[i] != b[i] ) return ( a[i] < b[i] )?-1:1;
+	}
+	return 0;
+}
+
+// Compare two normalized arrays of any length
+static inline int LimbCmp( const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	if ( an != bn ) return ( an < bn )?-1:1;
+	return LimbCmp( a, b, an );
+}
+
+// r = a + b, all of length n, return the carry
+static inline LimbType LimbAddN( LimbType *r, const LimbType *a, const LimbType *b, SizeType n ) {
+	LimbType carry = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		LimbType s = a[i] + carry;
+		carry = ( s < carry );
+		LimbType t = s + b[i];
+		carry += ( t < s );
+		r[i] = t;
+	}
+	return carry;
+}
+
+// r = a + b, an >= bn, r has an limbs, return the carry
+static inline LimbType LimbAdd( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	LimbType carry = LimbAddN( r, a, b, bn );
+	for ( SizeType i = bn; i < an; i++ ) {
+		LimbType s = a[i] + carry;
+		carry = ( s < carry );
+		r[i] = s;
+	}
+	return carry;
+}
+
+// r = a + b for a single limb b, return the carry
+static inline LimbType LimbAdd1( LimbType *r, const LimbType *a, SizeType n, LimbType b ) {
+	for ( SizeType i = 0; i < n; i++ ) {
+		LimbType s = a[i] + b;
+		b = ( s < b );
+		r[i] = s;
+	}
+	return b;
+}
+
+// r = a - b, all of length n, return the borrow
+static inline LimbType LimbSubN( LimbType *r, const LimbType *a, const LimbType *b, SizeType n ) {
+	LimbType borrow = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		LimbType s = a[i] - b[i];
+		LimbType b1 = ( s > a[i] );
+		LimbType t = s - borrow;
+		borrow = b1 + ( t > s );
+		r[i] = t;
+	}
+	return borrow;
+}
+
+// r = a - b, an >= bn, r has an limbs, return the borrow
+static inline LimbType LimbSub( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	LimbType borrow = LimbSubN( r, a, b, bn );
+	for ( SizeType i = bn; i < an; i++ ) {
+		LimbType s = a[i] - borrow;
+		borrow = ( s > a[i] );
+		r[i] = s;
+	}
+	return borrow;
+}
+
+// r = a - b for a single limb b, return the borrow
+static inline LimbType LimbSub1( LimbType *r, const LimbType *a, SizeType n, LimbType b ) {
+	for ( SizeType i = 0; i < n; i++ ) {
+		LimbType s = a[i] - b;
+		b = ( s > a[i] );
+		r[i] = s;
+	}
+	return b;
+}
+
+// r = a * b, return the high limb
+static inline LimbType LimbMul1( LimbType *r, const LimbType *a, SizeType n, LimbType b ) {
+	LimbType carry = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		DLimbType t = (DLimbType)a[i] * b + carry;
+		r[i] = (LimbType)t;
+		carry = (LimbType)( t >> LIMB_BITS );
+	}
+	return carry;
+}
+
+// r += a * b, return the carry out of r[n-1]
+static inline LimbType LimbAddMul1( LimbType *r, const LimbType *a, SizeType n, LimbType b ) {
+	LimbType carry = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		DLimbType t = (DLimbType)a[i] * b + r[i] + carry;
+		r[i] = (LimbType)t;
+		carry = (LimbType)( t >> LIMB_BITS );
+	}
+	return carry;
+}
+
+// r -= a * b, return the borrow out of r[n-1]
+static inline LimbType LimbSubMul1( LimbType *r, const LimbType *a, SizeType n, LimbType b ) {
+	LimbType borrow = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		DLimbType t = (DLimbType)a[i] * b + borrow;
+		LimbType lo = (LimbType)t;
+		borrow = (LimbType)( t >> LIMB_BITS );
+		LimbType s = r[i] - lo;
+		borrow += ( s > r[i] );
+		r[i] = s;
+	}
+	return borrow;
+}
+
+// r = a * b ( schoolbook ), r must not overlap a or b and has an + bn limbs
+static inline void LimbMulBasecase( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	r[an] = LimbMul1( r, a, an, b[0] );
+	for ( SizeType j = 1; j < bn; j++ ) {
+		r[an+j] = LimbAddMul1( r + j, a, an, b[j] );
+	}
+}
+
+// Store v into r ( at most 64 bits ), return the number of used limbs
+static inline SizeType LimbFromU64( LimbType *r, uint64_t v ) {
+	SizeType n = 0;
+	while ( v != 0 ) {
+		r[n++] = (LimbType)v;
+		v = ( LIMB_BITS < 64 )?( v >> ( LIMB_BITS % 64 ) ):0;
+	}
+	return n;
+}
+
+// Value of a[0..n) ( at most 64 bits )
+static inline uint64_t LimbToU64( const LimbType *a, SizeType n ) {
+	uint64_t v = 0;
+	for ( SizeType i = n - 1; i >= 0; i-- ) v = ( v << ( LIMB_BITS % 64 ) ) | a[i];
+	return v;
+}
+
+// Little endian integer of bytes <= 8 bytes at p, independent of the host order
+static inline uint64_t LoadLE( const uint8_t *p, int bytes ) {
+	uint64_t v = 0;
+	for ( int i = 0; i < bytes; i++ ) v |= (uint64_t)p[i] << ( 8 * i );
+	return v;
+}
+
+static inline void StoreLE( uint8_t *p, uint64_t v, int bytes ) {
+	for ( int i = 0; i < bytes; i++ ) p[i] = (uint8_t)( v >> ( 8 * i ) );
+}
+
+// q = a / d, return a % d
+static inline LimbType LimbDivMod1( LimbType *q, const LimbType *a, SizeType n, LimbType d ) {
+	LimbType r = 0;
+	for ( SizeType i = n - 1; i >= 0; i-- ) {
+		DLimbType t = ( (DLimbType)r << LIMB_BITS ) | a[i];
+		q[i] = (LimbType)( t / d );
+		r = (LimbType)( t % d );
+	}
+	return r;
+}
+
+// Return a % d
+static inline LimbType LimbMod1( const LimbType *a, SizeType n, LimbType d ) {
+	LimbType r = 0;
+	for ( SizeType i = n - 1; i >= 0; i-- ) {
+		DLimbType t = ( (DLimbType)r << LIMB_BITS ) | a[i];
+		r = (LimbType)( t % d );
+	}
+	return r;
+}
+
+// r = a << cnt with 0 < cnt < LIMB_BITS, return the bits shifted out
+static inline LimbType LimbLshift( LimbType *r, const LimbType *a, SizeType n, int cnt ) {
+	LimbType out = a[n-1] >> ( LIMB_BITS - cnt );
+	for ( SizeType i = n - 1; i > 0; i-- ) {
+		r[i] = ( a[i] << cnt ) | ( a[i-1] >> ( LIMB_BITS - cnt ) );
+	}
+	r[0] = a[0] << cnt;
+	return out;
+}
+
+// r = a >> cnt with 0 < cnt < LIMB_BITS, return the bits shifted out ( in the high end )
+static inline LimbType LimbRshift( LimbType *r, const LimbType *a, SizeType n, int cnt ) {
+	LimbType out = a[0] << ( LIMB_BITS - cnt );
+	for ( SizeType i = 0; i < n - 1; i++ ) {
+		r[i] = ( a[i] >> cnt ) | ( a[i+1] << ( LIMB_BITS - cnt ) );
+	}
+	r[n-1] = a[n-1] >> cnt;
+	return out;
+}
+
+// Inverse of an odd limb modulo 2^LIMB_BITS by Newton iteration
+static inline LimbType LimbInverse( LimbType m0 ) {
+	LimbType inv = m0;		// correct to 3 bits
+	for ( int i = 3; i < LIMB_BITS; i *= 2 ) inv *= 2 - m0 * inv;
+	return inv;
+}
+
+// Number of leading zero bits of a non-zero limb
+static inline int LimbClz( LimbType x ) {
+#ifdef BIGINT_LIMB32
+	return __builtin_clz( x );
+#else
+	return __builtin_clzll( x );
+#endif
+}
+
+// Number of trailing zero bits of a non-zero limb
+static inline int LimbCtz( LimbType x ) {
+#ifdef BIGINT_LIMB32
+	return __builtin_ctz( x );
+#else
+	return __builtin_ctzll( x );
+#endif
+}
+
+// Knuth Algorithm D: q = a / b ( an - bn + 1 limbs ), r = a % b ( bn limbs )
+// for an >= bn >= 2 and b[bn-1] != 0, ws is scratch of an + bn + 1 limbs
+// q and r must not overlap a, b or ws
+static void LimbDivRem( LimbType *q, LimbType *r, const LimbType *a, SizeType an,
+		const LimbType *b, SizeType bn, LimbType *ws ) {
+	LimbType *vn = ws, *un = ws + bn;
+
+	// normalize so that the top bit of the divisor is set
+	int s = LimbClz( b[bn-1] );
+	if ( s ) {
+		LimbLshift( vn, b, bn, s );
+		un[an] = LimbLshift( un, a, an, s );
+	} else {
+		memcpy( vn, b, bn * sizeof( LimbType ) );
+		memcpy( un, a, an * sizeof( LimbType ) );
+		un[an] = 0;
+	}
+
+	const LimbType d1 = vn[bn-1], d0 = vn[bn-2];
+	const DLimbType base = (DLimbType)1 << LIMB_BITS;
+	for ( SizeType j = an - bn; j >= 0; j-- ) {
+		// estimate the quotient limb from the top two limbs, then refine with
+		// the third one so that it is too large by at most one
+		DLimbType num = ( (DLimbType)un[j+bn] << LIMB_BITS ) | un[j+bn-1];
+		DLimbType qhat = num / d1;
+		DLimbType rhat = num % d1;
+		while ( qhat >= base || qhat * d0 > ( ( rhat << LIMB_BITS ) | un[j+bn-2] ) ) {
+			qhat--;
+			rhat += d1;
+			if ( rhat >= base ) break;
+		}
+
+		// multiply and subtract, add back in the rare case qhat was one too large
+		LimbType borrow = LimbSubMul1( un + j, vn, bn, (LimbType)qhat );
+		LimbType top = un[j+bn];
+		un[j+bn] = top - borrow;
+		if ( top < borrow ) {
+			qhat--;
+			un[j+bn] += LimbAddN( un + j, un + j, vn, bn );
+		}
+		q[j] = (LimbType)qhat;
+	}
+
+	// denormalize the remainder
+	if ( s ) LimbRshift( r, un, bn, s );
+	else memcpy( r, un, bn * sizeof( LimbType ) );
+}
+
+#endif
@@ -0,0 +1,409 @@
+/*************************************************************************
+*
+* Header file LimbMul.h
+*	size dispatched multiplication and squaring on limb arrays
+*	schoolbook -> Karatsuba -> Toom-3 -> three-prime NTT
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef LIMBMUL_H
+#define LIMBMUL_H
+
+#include <vector>
+#include <algorithm>
+
+#include "Limb.h"
+#include "LimbPool.h"
+
+// Operand sizes ( in limbs ) where the next algorithm starts to win
+const SizeType MUL_KARATSUBA_THRESHOLD = 32;
+const SizeType MUL_TOOM3_THRESHOLD = 160;
+const SizeType SQR_KARATSUBA_THRESHOLD = 40;
+const SizeType SQR_TOOM3_THRESHOLD = 200;
+
+static void LimbMulN( LimbType *r, const LimbType *a, const LimbType *b, SizeType n );
+static void LimbSqrN( LimbType *r, const LimbType *a, SizeType n );
+static void LimbMul( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn );
+
+// r = a^2 ( schoolbook ), off-diagonal products computed once and doubled
+// r must not overlap a and has 2n limbs
+static void LimbSqrBasecase( LimbType *r, const LimbType *a, SizeType n ) {
+	memset( r, 0, 2 * n * sizeof( LimbType ) );
+	for ( SizeType i = 0; i + 1 < n; i++ ) {
+		r[i+n] = LimbAddMul1( r + 2 * i + 1, a + i + 1, n - i - 1, a[i] );
+	}
+	LimbLshift( r, r, 2 * n, 1 );
+	LimbType cy = 0;
+	for ( SizeType i = 0; i < n; i++ ) {
+		DLimbType sq = (DLimbType)a[i] * a[i];
+		DLimbType t = (DLimbType)r[2*i] + (LimbType)sq + cy;
+		r[2*i] = (LimbType)t;
+		t = (DLimbType)r[2*i+1] + (LimbType)( sq >> LIMB_BITS ) + (LimbType)( t >> LIMB_BITS );
+		r[2*i+1] = (LimbType)t;
+		cy = (LimbType)( t >> LIMB_BITS );
+	}
+}
+
+// r = |a - b| for a of n limbs and b of m <= n limbs, return 1 if a < b
+static int LimbAbsDiff( LimbType *r, const LimbType *a, SizeType n, const LimbType *b, SizeType m ) {
+	SizeType an = LimbNormSize( a, n );
+	SizeType bn = LimbNormSize( b, m );
+	if ( LimbCmp( a, an, b, bn ) >= 0 ) {
+		LimbSub( r, a, n, b, m );
+		return 0;
+	}
+	memset( r, 0, n * sizeof( LimbType ) );
+	memcpy( r, b, m * sizeof( LimbType ) );
+	LimbSubN( r, r, a, n );
+	return 1;
+}
+
+// r = a * b for n-limb operands ( a == b squares ), Karatsuba with the
+// subtractive middle term: a0*b1 + a1*b0 = a0*b0 + a1*b1 - (a0-a1)*(b0-b1)
+static void LimbMulKaratsuba( LimbType *r, const LimbType *a, const LimbType *b, SizeType n ) {
+	bool sqr = ( a == b );
+	SizeType h = ( n + 1 ) / 2;
+	SizeType l = n - h;
+	LimbVector ws( 4 * h + 1 );
+	LimbType *da = ws.data(), *db = da + h, *z1 = db + h;
+
+	int neg = LimbAbsDiff( da, a, h, a + h, l );
+	if ( sqr ) {
+		neg = 0;
+		LimbSqrN( z1, da, h );
+		LimbSqrN( r, a, h );
+		LimbSqrN( r + 2 * h, a + h, l );
+	} else {
+		neg ^= LimbAbsDiff( db, b, h, b + h, l );
+		LimbMulN( z1, da, db, h );
+		LimbMulN( r, a, b, h );
+		LimbMulN( r + 2 * h, a + h, b + h, l );
+	}
+
+	// middle = z0 + z2 -/+ z1, 2h+1 limbs, added at offset h
+	LimbVector mid( 2 * h + 1 );
+	mid[2*h] = LimbAdd( mid.data(), r, 2 * h, r + 2 * h, 2 * l );
+	if ( neg ) mid[2*h] += LimbAddN( mid.data(), mid.data(), z1, 2 * h );
+	else mid[2*h] -= LimbSubN( mid.data(), mid.data(), z1, 2 * h );
+	LimbAdd( r + h, r + h, 2 * n - h, mid.data(), 2 * h + 1 );
+}
+
+// r = a * b for n-limb operands ( a == b squares ), Toom-3 with the
+// evaluation points 0, 1, -1, 2, infinity
+static void LimbMulToom3( LimbType *r, const LimbType *a, const LimbType *b, SizeType n ) {
+	bool sqr = ( a == b );
+	SizeType k = ( n + 2 ) / 3;
+	SizeType s = n - 2 * k;
+	SizeType k1 = k + 1, k2 = 2 * k + 2;
+	const LimbType *a0 = a, *a1 = a + k, *a2 = a + 2 * k;
+	const LimbType *b0 = b, *b1 = b + k, *b2 = b + 2 * k;
+
+	// evaluation, every value fits in k+1 limbs
+	LimbVector ev( 6 * k1, 0 );
+	LimbType *ap1 = ev.data(), *apm1 = ap1 + k1, *ap2 = apm1 + k1;
+	LimbType *bp1 = ap2 + k1, *bpm1 = bp1 + k1, *bp2 = bpm1 + k1;
+	int negm1 = 0;
+	{
+		LimbVector t( k1 );
+		for ( int pass = 0; pass < ( sqr?1:2 ); pass++ ) {
+			const LimbType *x0 = pass?b0:a0, *x1 = pass?b1:a1, *x2 = pass?b2:a2;
+			LimbType *p1 = pass?bp1:ap1, *pm1 = pass?bpm1:apm1, *p2 = pass?bp2:ap2;
+			// t = x0 + x2
+			t[k] = LimbAdd( t.data(), x0, k, x2, s );
+			// p1 = t + x1, pm1 = |t - x1|
+			p1[k] = t[k] + LimbAddN( p1, t.data(), x1, k );
+			LimbVector x1p( k1, 0 );
+			memcpy( x1p.data(), x1, k * sizeof( LimbType ) );
+			negm1 ^= LimbAbsDiff( pm1, t.data(), k1, x1p.data(), k1 );
+			// p2 = x0 + 2 * ( x1 + 2 * x2 )
+			memset( p2, 0, k1 * sizeof( LimbType ) );
+			memcpy( p2, x2, s * sizeof( LimbType ) );
+			LimbLshift( p2, p2, k1, 1 );
+			LimbAdd( p2, p2, k1, x1, k );
+			LimbLshift( p2, p2, k1, 1 );
+			LimbAdd( p2, p2, k1, x0, k );
+		}
+	}
+
+	// pointwise products, v0 and vinf go straight to their place in r
+	LimbVector pv( 3 * k2 );
+	LimbType *v1 = pv.data(), *vm1 = v1 + k2, *v2 = vm1 + k2;
+	LimbType *v0 = r, *vinf = r + 4 * k;
+	memset( r, 0, 2 * n * sizeof( LimbType ) );
+	if ( sqr ) {
+		LimbSqrN( v1, ap1, k1 );
+		LimbSqrN( vm1, apm1, k1 );
+		LimbSqrN( v2, ap2, k1 );
+		LimbSqrN( v0, a0, k );
+		LimbSqrN( vinf, a2, s );
+		negm1 = 0;
+	} else {
+		LimbMulN( v1, ap1, bp1, k1 );
+		LimbMulN( vm1, apm1, bpm1, k1 );
+		LimbMulN( v2, ap2, bp2, k1 );
+		LimbMulN( v0, a0, b0, k );
+		LimbMulN( vinf, a2, b2, s );
+	}
+
+	// interpolation, every intermediate value is a non-negative combination
+	LimbVector iv( 4 * k2, 0 );
+	LimbType *c1 = iv.data(), *c2 = c1 + k2, *c3 = c2 + k2, *tmp = c3 + k2;
+	LimbVector v0p( k2, 0 ), vinfp( k2, 0 );
+	memcpy( v0p.data(), v0, 2 * k * sizeof( LimbType ) );
+	memcpy( vinfp.data(), vinf, 2 * s * sizeof( LimbType ) );
+
+	// c1 = ( v1 - vm1 ) / 2 = c1 + c3
+	if ( negm1 ) LimbAddN( c1, v1, vm1, k2 );
+	else LimbSubN( c1, v1, vm1, k2 );
+	LimbRshift( c1, c1, k2, 1 );
+	// c2 = ( v1 + vm1 ) / 2 - v0 - vinf
+	if ( negm1 ) LimbSubN( c2, v1, vm1, k2 );
+	else LimbAddN( c2, v1, vm1, k2 );
+	LimbRshift( c2, c2, k2, 1 );
+	LimbSubN( c2, c2, v0p.data(), k2 );
+	LimbSubN( c2, c2, vinfp.data(), k2 );
+	// c3 = ( ( v2 - vm1 ) / 3 - ( c1 + c3 ) - c2 - 5 vinf ) / 2
+	if ( negm1 ) LimbAddN( c3, v2, vm1, k2 );
+	else LimbSubN( c3, v2, vm1, k2 );
+	LimbDivMod1( c3, c3, k2, 3 );
+	LimbSubN( c3, c3, c1, k2 );
+	LimbSubN( c3, c3, c2, k2 );
+	LimbMul1( tmp, vinfp.data(), k2, 5 );
+	LimbSubN( c3, c3, tmp, k2 );
+	LimbRshift( c3, c3, k2, 1 );
+	// c1 = ( c1 + c3 ) - c3
+	LimbSubN( c1, c1, c3, k2 );
+
+	// recomposition r += c1 B^k + c2 B^2k + c3 B^3k
+	LimbType *coef[3] = { c1, c2, c3 };
+	for ( int i = 0; i < 3; i++ ) {
+		SizeType off = ( i + 1 ) * k;
+		SizeType len = LimbNormSize( coef[i], k2 );
+		if ( len > 0 ) LimbAdd( r + off, r + off, 2 * n - off, coef[i], len );
+	}
+}
+
+// Number theoretic transform over three word-sized primes p = c*2^k + 1 below
+// 2^(LIMB_BITS-1), every limb is one coefficient and the exact convolution is
+// recombined by CRT ( Garner ), there is no floating point rounding anywhere
+#ifdef BIGINT_LIMB32
+const LimbType NTT_PRIMES[3] = { 2013265921u, 469762049u, 754974721u };
+const LimbType NTT_ROOTS[3] = { 31, 3, 11 };		// primitive roots
+const int NTT_MAXLOG = 24;				// transform length <= 2^NTT_MAXLOG
+#else
+const LimbType NTT_PRIMES[3] = { 0x7fffe00000000001ull, 0x7ff5a00000000001ull, 0x7ff4a00000000001ull };
+const LimbType NTT_ROOTS[3] = { 5, 3, 5 };
+const int NTT_MAXLOG = 45;
+#endif
+const SizeType NTT_MAXLEN = (SizeType)1 << NTT_MAXLOG;
+const SizeType MUL_NTT_THRESHOLD = 3500;
+const SizeType SQR_NTT_THRESHOLD = 3500;
+
+// Montgomery arithmetic modulo a word-sized prime p < 2^(LIMB_BITS-1)
+struct NttPrime {
+	LimbType p;
+	LimbType pinv;		// -p^(-1) mod 2^LIMB_BITS
+	LimbType r2;		// R^2 mod p, R = 2^LIMB_BITS
+
+	NttPrime( LimbType q ):p(q),pinv(0 - LimbInverse( q )) {
+		LimbType r1 = ( LIMB_MAX % p + 1 ) % p;
+		r2 = (LimbType)( (DLimbType)r1 * r1 % p );
+	};
+
+	// a * b * R^(-1) mod p
+	LimbType Mul( LimbType a, LimbType b ) const {
+		DLimbType t = (DLimbType)a * b;
+		LimbType m = (LimbType)t * pinv;
+		LimbType u = (LimbType)( ( t + (DLimbType)m * p ) >> LIMB_BITS );
+		return ( u >= p )?u - p:u;
+	};
+	LimbType ToMont( LimbType a ) const { return Mul( a % p, r2 ); };
+	LimbType Add( LimbType a, LimbType b ) const { LimbType s = a + b; return ( s >= p )?s - p:s; };
+	LimbType Sub( LimbType a, LimbType b ) const { return ( a >= b )?a - b:a + p - b; };
+
+	// b^e for b in Montgomery form, result in Montgomery form
+	LimbType Pow( LimbType b, LimbType e ) const {
+		LimbType r = ToMont( 1 );
+		for ( ; e; e >>= 1 ) {
+			if ( e & 1 ) r = Mul( r, b );
+			b = Mul( b, b );
+		}
+		return r;
+	};
+};
+
+// Twiddle table: w[len + j] = ( primitive 2len-th root )^j for every len < n
+static void NttTwiddles( LimbType *w, SizeType n, const NttPrime &P, LimbType g, bool inverse ) {
+	for ( SizeType len = 1; len < n; len <<= 1 ) {
+		LimbType root = P.Pow( P.ToMont( g ), ( P.p - 1 ) / ( 2 * len ) );
+		if ( inverse ) root = P.Pow( root, 2 * len - 1 );
+		w[len] = P.ToMont( 1 );
+		for ( SizeType j = 1; j < len; j++ ) w[len+j] = P.Mul( w[len+j-1], root );
+	}
+}
+
+// Forward transform, decimation in frequency: natural order in, bit-reversed out
+static void NttForward( LimbType *a, SizeType n, const NttPrime P, const LimbType *w ) {
+	for ( SizeType len = n >> 1; len >= 1; len >>= 1 ) {
+		for ( SizeType i = 0; i < n; i += 2 * len ) {
+			for ( SizeType j = 0; j < len; j++ ) {
+				LimbType u = a[i+j], v = a[i+j+len];
+				a[i+j] = P.Add( u, v );
+				a[i+j+len] = P.Mul( P.Sub( u, v ), w[len+j] );
+			}
+		}
+	}
+}
+
+// Inverse transform ( unscaled ), decimation in time: bit-reversed in, natural out
+static void NttInverse( LimbType *a, SizeType n, const NttPrime P, const LimbType *w ) {
+	for ( SizeType len = 1; len < n; len <<= 1 ) {
+		for ( SizeType i = 0; i < n; i += 2 * len ) {
+			for ( SizeType j = 0; j < len; j++ ) {
+				LimbType u = a[i+j], v = P.Mul( a[i+j+len], w[len+j] );
+				a[i+j] = P.Add( u, v );
+				a[i+j+len] = P.Sub( u, v );
+			}
+		}
+	}
+}
+
+// r = a * b for an >= bn >= 1 with a product longer than one transform:
+// blocks of NTT_MAXLEN / 2 limbs of a and of b, multiplied and summed
+static void LimbMulNttBlocks( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	SizeType k = NTT_MAXLEN / 2;
+	LimbVector tmp( 2 * k );
+	memset( r, 0, ( an + bn ) * sizeof( LimbType ) );
+	for ( SizeType i = 0; i < an; i += k ) {
+		for ( SizeType j = 0; j < bn; j += k ) {
+			SizeType x = std::min( k, an - i ), y = std::min( k, bn - j );
+			if ( x >= y ) LimbMul( tmp.data(), a + i, x, b + j, y );
+			else LimbMul( tmp.data(), b + j, y, a + i, x );
+			LimbAdd( r + i + j, r + i + j, an + bn - i - j, tmp.data(), x + y );
+		}
+	}
+}
+
+// r = a * b for an >= bn >= 1 ( a == b squares ), r has an + bn limbs
+static void LimbMulNtt( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	bool sqr = ( a == b && an == bn );
+	SizeType len = an + bn - 1;
+	if ( len > NTT_MAXLEN ) {
+		LimbMulNttBlocks( r, a, an, b, bn );
+		return;
+	}
+	SizeType n = 1;
+	while ( n < len ) n <<= 1;
+
+	// convolution modulo each prime, the twiddles in Montgomery form keep the
+	// data in the plain domain, the pointwise product leaves a factor R^(-1)
+	LimbVector res[3];
+	LimbVector w( n ), fb;
+	for ( int k = 0; k < 3; k++ ) {
+		NttPrime P( NTT_PRIMES[k] );
+		LimbVector &fa = res[k];
+		fa.assign( n, 0 );
+		for ( SizeType i = 0; i < an; i++ ) fa[i] = a[i] % P.p;
+		NttTwiddles( w.data(), n, P, NTT_ROOTS[k], false );
+		NttForward( fa.data(), n, P, w.data() );
+		if ( sqr ) {
+			for ( SizeType i = 0; i < n; i++ ) fa[i] = P.Mul( fa[i], fa[i] );
+		} else {
+			fb.assign( n, 0 );
+			for ( SizeType i = 0; i < bn; i++ ) fb[i] = b[i] % P.p;
+			NttForward( fb.data(), n, P, w.data() );
+			for ( SizeType i = 0; i < n; i++ ) fa[i] = P.Mul( fa[i], fb[i] );
+		}
+		NttTwiddles( w.data(), n, P, NTT_ROOTS[k], true );
+		NttInverse( fa.data(), n, P, w.data() );
+		// scale by n^(-1) R to undo the transform length and the R^(-1)
+		LimbType ninv = P.p - ( P.p - 1 ) / n;
+		LimbType scale = P.Mul( P.ToMont( ninv ), P.r2 );
+		for ( SizeType i = 0; i < len; i++ ) fa[i] = P.Mul( fa[i], scale );
+	}
+
+	// Garner: x = v1 + v2 p1 + v3 p1 p2 with v2 < p2, v3 < p3
+	NttPrime P2( NTT_PRIMES[1] ), P3( NTT_PRIMES[2] );
+	const LimbType p1 = NTT_PRIMES[0], p2 = NTT_PRIMES[1];
+	LimbType inv12 = P2.Pow( P2.ToMont( p1 ), p2 - 2 );		// Montgomery form of p1^(-1) mod p2
+	LimbType inv13 = P3.Pow( P3.ToMont( p1 ), P3.p - 2 );
+	LimbType inv23 = P3.Pow( P3.ToMont( p2 ), P3.p - 2 );
+	DLimbType p12 = (DLimbType)p1 * p2;
+	LimbType q0 = (LimbType)p12, q1 = (LimbType)( p12 >> LIMB_BITS );
+
+	LimbType c0 = 0, c1 = 0, c2 = 0;
+	for ( SizeType i = 0; i < an + bn; i++ ) {
+		if ( i < len ) {
+			LimbType v1 = res[0][i];
+			LimbType v2 = P2.Mul( P2.Sub( res[1][i], v1 % p2 ), inv12 );
+			LimbType v3 = P3.Mul( P3.Sub( res[2][i], v1 % P3.p ), inv13 );
+			v3 = P3.Mul( P3.Sub( v3, v2 % P3.p ), inv23 );
+
+			DLimbType t = (DLimbType)v2 * p1 + v1;
+			DLimbType lo = (DLimbType)v3 * q0;
+			DLimbType hi = (DLimbType)v3 * q1 + (LimbType)( lo >> LIMB_BITS );
+			// ( x0, x1, x2 ) = t + v3 * p1 p2
+			DLimbType s = (DLimbType)(LimbType)t + (LimbType)lo;
+			LimbType x0 = (LimbType)s;
+			s = ( s >> LIMB_BITS ) + (LimbType)( t >> LIMB_BITS ) + (LimbType)hi;
+			LimbType x1 = (LimbType)s;
+			LimbType x2 = (LimbType)( s >> LIMB_BITS ) + (LimbType)( hi >> LIMB_BITS );
+
+			s = (DLimbType)c0 + x0;
+			c0 = (LimbType)s;
+			s = ( s >> LIMB_BITS ) + c1 + x1;
+			c1 = (LimbType)s;
+			c2 += x2 + (LimbType)( s >> LIMB_BITS );
+		}
+		r[i] = c0;
+		c0 = c1;
+		c1 = c2;
+		c2 = 0;
+	}
+}
+
+// r = a * b for n-limb operands, r must not overlap a or b and has 2n limbs
+static void LimbMulN( LimbType *r, const LimbType *a, const LimbType *b, SizeType n ) {
+	if ( a == b ) LimbSqrN( r, a, n );
+	else if ( n < MUL_KARATSUBA_THRESHOLD ) LimbMulBasecase( r, a, n, b, n );
+	else if ( n < MUL_TOOM3_THRESHOLD ) LimbMulKaratsuba( r, a, b, n );
+	else if ( n < MUL_NTT_THRESHOLD ) LimbMulToom3( r, a, b, n );
+	else LimbMulNtt( r, a, n, b, n );
+}
+
+// r = a^2 for an n-limb operand, r must not overlap a and has 2n limbs
+static void LimbSqrN( LimbType *r, const LimbType *a, SizeType n ) {
+	if ( n < SQR_KARATSUBA_THRESHOLD ) LimbSqrBasecase( r, a, n );
+	else if ( n < SQR_TOOM3_THRESHOLD ) LimbMulKaratsuba( r, a, a, n );
+	else if ( n < SQR_NTT_THRESHOLD ) LimbMulToom3( r, a, a, n );
+	else LimbMulNtt( r, a, n, a, n );
+}
+
+// r = a * b for an >= bn >= 1, r must not overlap a or b and has an + bn limbs
+// Unbalanced operands are cut into bn-limb pieces of a
+static void LimbMul( LimbType *r, const LimbType *a, SizeType an, const LimbType *b, SizeType bn ) {
+	if ( an == bn ) {
+		LimbMulN( r, a, b, an );
+		return;
+	}
+	if ( bn < MUL_KARATSUBA_THRESHOLD ) {
+		LimbMulBasecase( r, a, an, b, bn );
+		return;
+	}
+	if ( bn >= MUL_NTT_THRESHOLD ) {
+		LimbMulNtt( r, a, an, b, bn );
+		return;
+	}
+	LimbVector tmp( 2 * bn );
+	memset( r, 0, ( an + bn ) * sizeof( LimbType ) );
+	for ( SizeType i = 0; i < an; i += bn ) {
+		SizeType len = std::min<SizeType>( bn, an - i );
+		if ( len == bn ) LimbMulN( tmp.data(), a + i, b, bn );
+		else LimbMul( tmp.data(), b, bn, a + i, len );
+		LimbAdd( r + i, r + i, an + bn - i, tmp.data(), len + bn );
+	}
+}
+
+#endif
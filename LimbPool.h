@@ -0,0 +1,117 @@
+/*************************************************************************
+*
+* Header file LimbPool.h
+*	thread local pool of limb buffers behind the BigInt temporaries
+*	freed buffers are cached per power of two size class and handed
+*	out again, so loops on numbers of a fixed size stop calling malloc
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef LIMBPOOL_H
+#define LIMBPOOL_H
+
+#include <vector>
+#include <new>
+#include <stddef.h>
+
+#include "Limb.h"
+
+const int LIMB_POOL_MIN = 5;		// smallest block 2^5 bytes
+const int LIMB_POOL_MAX = 20;		// largest pooled block 2^20 bytes, larger ones go to malloc
+const size_t LIMB_POOL_DEPTH = 64;	// cached blocks per size class
+
+// Free blocks of the calling thread, released when the thread exits
+struct LimbPool {
+	std::vector<void *> blocks[LIMB_POOL_MAX - LIMB_POOL_MIN + 1];
+	uint64_t hits, misses;		// allocations served from the cache / by malloc
+
+	LimbPool();
+	~LimbPool();
+};
+
+// Set once the pool of the thread is destroyed, later frees go to malloc
+inline bool &LimbPoolDown() {
+	static thread_local bool down = false;
+	return down;
+}
+
+inline LimbPool::LimbPool():hits(0),misses(0) {
+	// the free lists never grow, so a free never allocates
+	for ( int c = 0; c <= LIMB_POOL_MAX - LIMB_POOL_MIN; c++ ) blocks[c].reserve( LIMB_POOL_DEPTH );
+}
+
+inline LimbPool::~LimbPool() {
+	for ( int c = 0; c <= LIMB_POOL_MAX - LIMB_POOL_MIN; c++ ) {
+		for ( size_t i = 0; i < blocks[c].size(); i++ ) ::operator delete( blocks[c][i] );
+	}
+	LimbPoolDown() = true;
+}
+
+// Pool of the calling thread, NULL during thread exit
+inline LimbPool *ThreadLimbPool() {
+	if ( LimbPoolDown() ) return NULL;
+	static thread_local LimbPool pool;
+	return &pool;
+}
+
+// Size class of a block of bytes ( 2^( LIMB_POOL_MIN + class ) bytes ), -1 when not pooled
+static inline int LimbPoolClass( size_t bytes ) {
+	if ( bytes <= ( (size_t)1 << LIMB_POOL_MIN ) ) return 0;
+	int lg = 64 - __builtin_clzll( (unsigned long long)( bytes - 1 ) );
+	return ( lg <= LIMB_POOL_MAX )?lg - LIMB_POOL_MIN:-1;
+}
+
+inline void *LimbPoolAlloc( size_t bytes ) {
+	int c = LimbPoolClass( bytes );
+	LimbPool *pool = ( c >= 0 )?ThreadLimbPool():NULL;
+	if ( pool == NULL ) return ::operator new( bytes );
+	if ( !pool->blocks[c].empty() ) {
+		void *p = pool->blocks[c].back();
+		pool->blocks[c].pop_back();
+		pool->hits++;
+		return p;
+	}
+	pool->misses++;
+	return ::operator new( (size_t)1 << ( c + LIMB_POOL_MIN ) );
+}
+
+// bytes must be the size given to LimbPoolAlloc, the block may come from another thread
+inline void LimbPoolFree( void *p, size_t bytes ) {
+	if ( p == NULL ) return;
+	int c = LimbPoolClass( bytes );
+	LimbPool *pool = ( c >= 0 )?ThreadLimbPool():NULL;
+	if ( pool == NULL || pool->blocks[c].size() >= LIMB_POOL_DEPTH ) {
+		::operator delete( p );
+		return;
+	}
+	pool->blocks[c].push_back( p );
+}
+
+// Allocator of the limb vectors, build with -DBIGINT_STD_ALLOC to go back to
+// std::allocator ( for example under a memory checker )
+template <typename T>
+struct LimbAllocator {
+	typedef T value_type;
+
+	LimbAllocator() {};
+	template <typename U> LimbAllocator( const LimbAllocator<U> & ) {};
+
+	T *allocate( size_t n ) { return (T *)LimbPoolAlloc( n * sizeof( T ) ); };
+	void deallocate( T *p, size_t n ) { LimbPoolFree( p, n * sizeof( T ) ); };
+};
+
+template <typename T, typename U>
+bool operator==( const LimbAllocator<T> &, const LimbAllocator<U> & ) { return true; }
+
+template <typename T, typename U>
+bool operator!=( const LimbAllocator<T> &, const LimbAllocator<U> & ) { return false; }
+
+#ifdef BIGINT_STD_ALLOC
+typedef std::vector<LimbType> LimbVector;
+#else
+typedef std::vector< LimbType, LimbAllocator<LimbType> > LimbVector;
+#endif
+
+#endif
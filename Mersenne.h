@@ -0,0 +1,132 @@
+/*************************************************************************
+*
+* Header file Mersenne.h
+*	reduction modulo Mersenne numbers 2^p - 1 by shift and add
+*	and the Lucas-Lehmer test for Mersenne primes
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef MERSENNE_H
+#define MERSENNE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "BigInt.h"
+#include "Montgomery.h"
+
+// Return p if |m| = 2^p - 1 with p >= 2, else 0
+inline SizeType MersenneExponent( const BigInt &m ) {
+	if ( m.size == 0 ) return 0;
+	for ( SizeType i = 0; i + 1 < m.size; i++ ) {
+		if ( m.limbs[i] != LIMB_MAX ) return 0;
+	}
+	LimbType top = m.limbs[m.size-1];
+	if ( top & ( top + 1 ) ) return 0;
+	SizeType p = m.BitLength();
+	return ( p >= 2 )?p:0;
+}
+
+// Residues modulo m = 2^p - 1 kept as plain n-limb arrays below m,
+// a product t = hi * 2^p + lo reduces to lo + hi since 2^p = 1 ( mod m )
+struct MersenneMod {
+	SizeType p;
+	SizeType n;		// number of limbs of m ( 0 for p = 0, unprepared )
+	BigInt m;
+
+	MersenneMod( SizeType pw );
+
+	void Reduce( LimbType *r, LimbType *t ) const;
+	void Mul( LimbType *r, const LimbType *a, const LimbType *b, LimbType *t ) const;
+	void Sqr( LimbType *r, const LimbType *a, LimbType *t ) const;
+	void Convert( LimbType *r, const BigInt &a, LimbType *t ) const;
+	BigInt Revert( const LimbType *a, LimbType *t ) const;
+	BigInt Pow( BigInt b, const BigInt &e, PowProgress *progress = NULL ) const;
+};
+
+inline MersenneMod::MersenneMod( SizeType pw ):p(pw),n(0) {
+	if ( p < 2 ) return;
+	n = ( p + LIMB_BITS - 1 ) / LIMB_BITS;
+	m = BigInt( 1 ) << p;
+	m -= 1;
+}
+
+// r = t mod m for t < 2^(2p) of 2n limbs ( t is destroyed ), r may not alias t
+inline void MersenneMod::Reduce( LimbType *r, LimbType *t ) const {
+	SizeType ls = p / LIMB_BITS;
+	int bs = p % LIMB_BITS;
+
+	// r = t >> p, then t = t mod 2^p
+	for ( SizeType i = 0; i < n; i++ ) {
+		if ( bs == 0 ) r[i] = t[ls+i];
+		else r[i] = ( t[ls+i] >> bs ) | ( t[ls+i+1] << ( LIMB_BITS - bs ) );
+	}
+	if ( bs ) t[n-1] &= ( (LimbType)1 << bs ) - 1;
+
+	// r = hi + lo < 2^(p+1), fold the bit p back in once more
+	LimbType cy = LimbAddN( r, r, t, n );
+	if ( bs ) {
+		cy = r[n-1] >> bs;
+		r[n-1] &= ( (LimbType)1 << bs ) - 1;
+	}
+	if ( cy ) LimbAdd1( r, r, n, 1 );
+	if ( LimbCmp( r, m.limbs.data(), n ) == 0 ) memset( r, 0, n * sizeof( LimbType ) );
+}
+
+// r = a * b mod m, t is scratch of 2n limbs, r may alias a or b
+inline void MersenneMod::Mul( LimbType *r, const LimbType *a, const LimbType *b, LimbType *t ) const {
+	LimbMulN( t, a, b, n );
+	Reduce( r, t );
+}
+
+// r = a^2 mod m, t is scratch of 2n limbs, r may alias a
+inline void MersenneMod::Sqr( LimbType *r, const LimbType *a, LimbType *t ) const {
+	LimbSqrN( t, a, n );
+	Reduce( r, t );
+}
+
+// r = a mod m for 0 <= a
+inline void MersenneMod::Convert( LimbType *r, const BigInt &a, LimbType * ) const {
+	BigInt x( a );
+	if ( x.CmpAbs( m ) >= 0 ) x = x % m;
+	memset( r, 0, n * sizeof( LimbType ) );
+	std::copy( x.limbs.begin(), x.limbs.begin() + x.size, r );
+}
+
+inline BigInt MersenneMod::Revert( const LimbType *a, LimbType * ) const {
+	BigInt rs;
+	rs.limbs.assign( a, a + n );
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
+}
+
+// Return b^e mod m for b >= 0, e >= 0
+inline BigInt MersenneMod::Pow( BigInt b, const BigInt &e, PowProgress *progress ) const {
+	return WindowPow( *this, b, e, progress );
+}
+
+// Lucas-Lehmer test: for an odd prime p, 2^p - 1 is prime iff s_(p-2) = 0
+// where s_0 = 4 and s_(i+1) = s_i^2 - 2 ( mod 2^p - 1 )
+inline bool LucasLehmer( DatType p ) {
+	if ( p == 2 ) return true;
+	if ( p < 2 || p % 2 == 0 ) return false;
+	// 2^p - 1 is composite for a composite p
+	for ( DatType d = 3; d * d <= p; d += 2 ) {
+		if ( p % d == 0 ) return false;
+	}
+
+	MersenneMod M( p );
+	SizeType n = M.n;
+	std::vector<LimbType> s( n, 0 ), t( 2 * n );
+	s[0] = 4;
+	for ( DatType i = 0; i < p - 2; i++ ) {
+		M.Sqr( s.data(), s.data(), t.data() );
+		if ( LimbSub1( s.data(), s.data(), n, 2 ) ) LimbAddN( s.data(), s.data(), M.m.limbs.data(), n );
+	}
+	return LimbNormSize( s.data(), n ) == 0 || LimbCmp( s.data(), M.m.limbs.data(), n ) == 0;
+}
+
+#endif
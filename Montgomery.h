@@ -0,0 +1,209 @@
+/*************************************************************************
+*
+* Header file Montgomery.h
+*	Montgomery multiplication context for BigInt odd moduli
+*	precomputed once per modulus, exponentiation without division
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef MONTGOMERY_H
+#define MONTGOMERY_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+
+#include "BigInt.h"
+
+// State of a resumable exponentiation b^e: the bits of e above bit are done
+// and acc = b^( e >> ( bit + 1 ) ) mod m as a plain residue ( bit = -1 before
+// the start ); due is polled after every window, when true bit and acc are
+// brought up to date and handed to save
+// stop is polled as well, once true the exponentiation is abandoned and its
+// result is meaningless ( a round whose test was decided by another one )
+struct PowProgress {
+	SizeType bit;
+	BigInt acc;
+	std::function<bool()> due;			// may be empty
+	std::function<void( const PowProgress & )> save;
+	const std::atomic<bool> *stop;			// may be NULL
+
+	PowProgress():bit(-1),stop(NULL) {};
+	// state before the first window
+	void Start( const BigInt &e ) { bit = e.BitLength() - 1; acc = 1; };
+};
+
+// Residues are kept as n-limb arrays a*R mod m with R = 2^(n*LIMB_BITS)
+struct Montgomery {
+	BigInt m;			// odd modulus
+	SizeType n;			// number of limbs of m
+	LimbType minv;			// -m^(-1) mod 2^LIMB_BITS
+	std::vector<LimbType> r2;	// R^2 mod m
+	std::vector<LimbType> one;	// R mod m, the Montgomery form of 1
+
+	Montgomery( const BigInt &mod );
+
+	void Redc( LimbType *r, LimbType *t ) const;
+	void Mul( LimbType *r, const LimbType *a, const LimbType *b, LimbType *t ) const;
+	void Sqr( LimbType *r, const LimbType *a, LimbType *t ) const;
+	void Convert( LimbType *r, const BigInt &a, LimbType *t ) const;
+	BigInt Revert( const LimbType *a, LimbType *t ) const;
+	BigInt Pow( BigInt b, const BigInt &e, PowProgress *progress = NULL ) const;
+};
+
+// Precompute -m^(-1) mod 2^LIMB_BITS and R^2 mod m ( the only division )
+// The modulus must be odd, other moduli are left unprepared ( n = 0 )
+inline Montgomery::Montgomery( const BigInt &mod ):m(mod),n(0),minv(0) {
+	m.sign = ( m.size > 0 )?1:0;
+	if ( m.size == 0 || ( m.limbs[0] & 1 ) == 0 ) return;
+	n = m.size;
+	minv = 0 - LimbInverse( m.limbs[0] );
+
+	BigInt rr;
+	rr.limbs.assign( 2 * n + 1, 0 );
+	rr.limbs[2*n] = 1;
+	rr.size = 2 * n + 1;
+	rr.sign = 1;
+	rr = rr % m;
+	r2.assign( n, 0 );
+	std::copy( rr.limbs.begin(), rr.limbs.begin() + rr.size, r2.begin() );
+
+	std::vector<LimbType> t( 2 * n );
+	std::vector<LimbType> unit( n, 0 );
+	unit[0] = 1;
+	one.resize( n );
+	Mul( one.data(), unit.data(), r2.data(), t.data() );
+}
+
+// r = t * R^(-1) mod m for t < m*R of 2n limbs ( t is destroyed )
+inline void Montgomery::Redc( LimbType *r, LimbType *t ) const {
+	const LimbType *mp = m.limbs.data();
+	for ( SizeType i = 0; i < n; i++ ) {
+		LimbType u = t[i] * minv;
+		// t[i] becomes zero, keep the carry there and add it at position i+n later
+		t[i] = LimbAddMul1( t + i, mp, n, u );
+	}
+	LimbType cy = LimbAddN( r, t + n, t, n );
+	if ( cy || LimbCmp( r, mp, n ) >= 0 ) LimbSubN( r, r, mp, n );
+}
+
+// r = a * b * R^(-1) mod m, t is scratch of 2n limbs, r may alias a or b
+inline void Montgomery::Mul( LimbType *r, const LimbType *a, const LimbType *b, LimbType *t ) const {
+	LimbMulN( t, a, b, n );
+	Redc( r, t );
+}
+
+// r = a^2 * R^(-1) mod m, t is scratch of 2n limbs, r may alias a
+inline void Montgomery::Sqr( LimbType *r, const LimbType *a, LimbType *t ) const {
+	LimbSqrN( t, a, n );
+	Redc( r, t );
+}
+
+// r = a * R mod m for 0 <= a
+inline void Montgomery::Convert( LimbType *r, const BigInt &a, LimbType *t ) const {
+	BigInt x( a );
+	if ( x.CmpAbs( m ) >= 0 ) x = x % m;
+	LimbVector xp( n, 0 );
+	std::copy( x.limbs.begin(), x.limbs.begin() + x.size, xp.begin() );
+	Mul( r, xp.data(), r2.data(), t );
+}
+
+// Return a * R^(-1) mod m as a BigInt
+inline BigInt Montgomery::Revert( const LimbType *a, LimbType *t ) const {
+	std::copy( a, a + n, t );
+	std::fill( t + n, t + 2 * n, 0 );
+	BigInt rs;
+	rs.limbs.resize( n );
+	Redc( rs.limbs.data(), t );
+	rs.sign = 1;
+	rs.Normalize();
+	return rs;
+}
+
+// Sliding window width for an exponent of the given bit length
+static inline int WindowWidth( SizeType bits ) {
+	if ( bits <= 8 ) return 1;
+	if ( bits <= 24 ) return 2;
+	if ( bits <= 80 ) return 3;
+	if ( bits <= 240 ) return 4;
+	if ( bits <= 672 ) return 5;
+	if ( bits <= 1792 ) return 6;
+	return 7;
+}
+
+// Return b^e mod m for b >= 0, e >= 0 with a modular engine E ( Montgomery,
+// MersenneMod ) providing n, m, Mul, Sqr, Convert and Revert on n-limb residues
+// Left-to-right sliding window over the bits of e with a table of odd powers
+// b, b^3, ..., b^(2^k - 1) in the residue form of E
+// With progress the exponentiation starts from its state ( see PowProgress ),
+// reports it whenever progress->due() asks for it and gives up on progress->stop
+template <typename Engine>
+BigInt WindowPow( const Engine &E, BigInt b, const BigInt &e, PowProgress *progress = NULL ) {
+	const SizeType n = E.n;
+	if ( e.sign == 0 ) return BigInt( 1 );
+	if ( b.sign < 0 ) b = b % E.m + E.m;
+
+	SizeType bits = e.BitLength();
+	int k = WindowWidth( bits );
+	SizeType tsz = (SizeType)1 << ( k - 1 );
+	// scratch kept per thread, reallocated only when a larger modulus comes
+	static thread_local std::vector<LimbType> t, acc, table, b2;
+	if ( (SizeType)table.size() < tsz * n ) table.resize( tsz * n );
+	if ( (SizeType)t.size() < 2 * n ) {
+		t.resize( 2 * n );
+		acc.resize( n );
+		b2.resize( n );
+	}
+	E.Convert( table.data(), b, t.data() );
+	if ( tsz > 1 ) {
+		E.Sqr( b2.data(), table.data(), t.data() );
+		for ( SizeType j = 1; j < tsz; j++ )
+			E.Mul( &table[j*n], &table[(j-1)*n], b2.data(), t.data() );
+	}
+
+	bool first = true;
+	SizeType i = bits - 1;
+	if ( progress && progress->bit >= 0 && progress->bit < bits - 1 ) {
+		// resume, the table only depends on b
+		i = std::max<SizeType>( progress->bit, -1 );
+		E.Convert( acc.data(), progress->acc, t.data() );
+		first = false;
+	}
+	while ( i >= 0 ) {
+		if ( progress && progress->stop && *progress->stop ) return BigInt();
+		if ( progress && progress->due && progress->due() ) {
+			progress->bit = i;
+			progress->acc = first?BigInt( 1 ):E.Revert( acc.data(), t.data() );
+			progress->save( *progress );
+		}
+		if ( !e.TestBit( i ) ) {
+			E.Sqr( acc.data(), acc.data(), t.data() );
+			i--;
+			continue;
+		}
+		// longest window of at most k bits ending in a set bit
+		SizeType l = std::max<SizeType>( i - k + 1, 0 );
+		while ( !e.TestBit( l ) ) l++;
+		int len = i - l + 1;
+		LimbType w = e.GetBits( l, len );
+		const LimbType *odd = &table[( w >> 1 ) * n];
+		if ( first ) {
+			std::copy( odd, odd + n, acc.data() );
+			first = false;
+		} else {
+			for ( int j = 0; j < len; j++ ) E.Sqr( acc.data(), acc.data(), t.data() );
+			E.Mul( acc.data(), acc.data(), odd, t.data() );
+		}
+		i = l - 1;
+	}
+	return E.Revert( acc.data(), t.data() );
+}
+
+inline BigInt Montgomery::Pow( BigInt b, const BigInt &e, PowProgress *progress ) const {
+	return WindowPow( *this, b, e, progress );
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*************************************************************************
+*
+* Header file Montgomery64.h
+*	Montgomery multiplication for single word moduli below 2^64
+*	with unsigned __int128 products, no overflow for the full range
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef MONTGOMERY64_H
+#define MONTGOMERY64_H
+
+typedef unsigned long long U64;
+typedef unsigned __int128 U128;
+
+// a * b mod m without overflow, one 128-bit division
+static inline U64 MulMod64( U64 a, U64 b, U64 m ) {
+	return (U64)( (U128)a * b % m );
+}
+
+// Residues are kept as x*R mod m with R = 2^64
+struct Montgomery64 {
+	U64 m;		// odd modulus
+	U64 minv;	// m^(-1) mod 2^64
+	U64 r2;		// R^2 mod m
+	U64 one;	// R mod m
+
+	Montgomery64():m(1),minv(1),r2(0),one(0) {};
+	Montgomery64( U64 mod );
+
+	// t * R^(-1) mod m for t < m*R
+	U64 Redc( U128 t ) const {
+		U64 q = (U64)t * minv;
+		U64 h = (U64)( ( (U128)q * m ) >> 64 );
+		U64 hi = (U64)( t >> 64 );
+		return ( hi < h )?hi - h + m:hi - h;
+	};
+	U64 Mul( U64 a, U64 b ) const { return Redc( (U128)a * b ); };
+	U64 Convert( U64 a ) const { return Mul( a % m, r2 ); };
+	U64 Revert( U64 a ) const { return Redc( a ); };
+	U64 Pow( U64 b, U64 e ) const;
+};
+
+inline Montgomery64::Montgomery64( U64 mod ):m(mod) {
+	// Newton iteration, each step doubles the correct low bits
+	minv = m;
+	for ( int i = 0; i < 5; i++ ) minv *= 2 - m * minv;
+	one = ( 0 - m ) % m;
+	r2 = MulMod64( one, one, m );
+}
+
+// Return b^e mod m, right-to-left square and multiply ( the squaring and
+// the accumulating chains are independent and overlap in the pipeline )
+inline U64 Montgomery64::Pow( U64 b, U64 e ) const {
+	if ( e == 0 ) return 1;
+	U64 x = Convert( b ), acc = one;
+	while ( true ) {
+		if ( e & 1 ) acc = Mul( acc, x );
+		e >>= 1;
+		if ( e == 0 ) break;
+		x = Mul( x, x );
+	}
+	return Revert( acc );
+}
+
+#endif
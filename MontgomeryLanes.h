@@ -0,0 +1,238 @@
+/*************************************************************************
+*
+* Header file MontgomeryLanes.h
+*	independent 64-bit modular exponentiations in lockstep, one modulus
+*	per SIMD lane ( AVX-512: 8 lanes, AVX2: 4 lanes ), chosen at run time
+*	with a scalar Montgomery64 fallback
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef MONTGOMERYLANES_H
+#define MONTGOMERYLANES_H
+
+#include <vector>
+
+#include "Limb.h"
+#include "Montgomery64.h"
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#define LANES_X86
+#endif
+
+// Montgomery constants of many odd moduli below 2^63, structure of arrays so
+// that a group of lanes is one vector load
+struct MontLanes {
+	std::vector<U64> m, minv, one, r2;
+
+	SizeType Size() const { return (SizeType)m.size(); };
+	void Clear() { m.clear(); minv.clear(); one.clear(); r2.clear(); };
+	void Push( const Montgomery64 &M ) {
+		m.push_back( M.m );
+		minv.push_back( M.minv );
+		one.push_back( M.one );
+		r2.push_back( M.r2 );
+	};
+	// lane to = lane from, used to compact the live lanes
+	void Move( SizeType to, SizeType from ) {
+		m[to] = m[from];
+		minv[to] = minv[from];
+		one[to] = one[from];
+		r2[to] = r2[from];
+	};
+	void Resize( SizeType n ) { m.resize( n ); minv.resize( n ); one.resize( n ); r2.resize( n ); };
+};
+
+// r[i] = b[i]^e[i] mod m[i] for i in [from, to), b[i] < m[i], scalar
+static void PowLanesScalar( U64 *r, const U64 *b, const U64 *e, const MontLanes &L, SizeType from, SizeType to ) {
+	for ( SizeType i = from; i < to; i++ ) {
+		Montgomery64 M;
+		M.m = L.m[i];
+		M.minv = L.minv[i];
+		M.one = L.one[i];
+		M.r2 = L.r2[i];
+		r[i] = M.Pow( b[i], e[i] );
+	}
+}
+
+#ifdef LANES_X86
+
+// The lane kernels use the same REDC as Montgomery64: with q = t * m^(-1) mod R,
+// t * R^(-1) = hi( t ) - hi( q * m ) ( mod m ), the result is exact in ( -m, m )
+// Right-to-left square and multiply: each lane multiplies at every exponent bit
+// and keeps the product where its own bit is set, the squaring chain runs
+// alongside
+
+#define LANES_AVX2 __attribute__(( target( "avx2" ) ))
+
+// Moduli below 2^32 use R = 2^32: a product is a single 32 x 32 -> 64 bit
+// multiply and the constants are minv mod 2^32 and R^2 = 2^64 mod m ( L.one )
+static inline LANES_AVX2 __m256i MontMul32x4( __m256i a, __m256i b, __m256i m, __m256i minv ) {
+	__m256i t = _mm256_mul_epu32( a, b );
+	__m256i qm = _mm256_mul_epu32( _mm256_mul_epu32( t, minv ), m );
+	__m256i r = _mm256_sub_epi64( _mm256_srli_epi64( t, 32 ), _mm256_srli_epi64( qm, 32 ) );
+	return _mm256_add_epi64( r, _mm256_and_si256( _mm256_cmpgt_epi64( _mm256_setzero_si256(), r ), m ) );
+}
+
+// Four lanes from i, all moduli below 2^32
+static LANES_AVX2 void PowLanes32Avx2( U64 *r, const U64 *b, const U64 *e, const MontLanes &L, SizeType i ) {
+	const __m256i one64 = _mm256_set1_epi64x( 1 );
+	__m256i m = _mm256_loadu_si256( (const __m256i *)&L.m[i] );
+	__m256i minv = _mm256_loadu_si256( (const __m256i *)&L.minv[i] );
+	__m256i rr = _mm256_loadu_si256( (const __m256i *)&L.one[i] );
+	__m256i ev = _mm256_loadu_si256( (const __m256i *)&e[i] );
+	__m256i x = MontMul32x4( _mm256_loadu_si256( (const __m256i *)&b[i] ), rr, m, minv );
+	__m256i acc = MontMul32x4( one64, rr, m, minv );
+	U64 emax = e[i] | e[i+1] | e[i+2] | e[i+3];
+	for ( ; emax; emax >>= 1 ) {
+		__m256i y = MontMul32x4( acc, x, m, minv );
+		__m256i bit = _mm256_and_si256( ev, one64 );
+		acc = _mm256_blendv_epi8( acc, y, _mm256_cmpeq_epi64( bit, one64 ) );
+		x = MontMul32x4( x, x, m, minv );
+		ev = _mm256_srli_epi64( ev, 1 );
+	}
+	_mm256_storeu_si256( (__m256i *)&r[i], MontMul32x4( acc, one64, m, minv ) );
+}
+
+#define LANES_AVX512 __attribute__(( target( "avx512f" ) ))
+
+// the AVX-512 intrinsics of some GCC versions trip a false uninitialized warning
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+static inline LANES_AVX512 void Mul128x8( __m512i a, __m512i b, __m512i &hi, __m512i &lo ) {
+	const __m512i m32 = _mm512_set1_epi64( 0xffffffffLL );
+	__m512i ah = _mm512_srli_epi64( a, 32 ), bh = _mm512_srli_epi64( b, 32 );
+	__m512i p00 = _mm512_mul_epu32( a, b );
+	__m512i p01 = _mm512_mul_epu32( a, bh );
+	__m512i p10 = _mm512_mul_epu32( ah, b );
+	__m512i p11 = _mm512_mul_epu32( ah, bh );
+	__m512i mid = _mm512_add_epi64( _mm512_srli_epi64( p00, 32 ), _mm512_and_si512( p01, m32 ) );
+	mid = _mm512_add_epi64( mid, _mm512_and_si512( p10, m32 ) );
+	lo = _mm512_or_si512( _mm512_and_si512( p00, m32 ), _mm512_slli_epi64( mid, 32 ) );
+	hi = _mm512_add_epi64( _mm512_add_epi64( p11, _mm512_srli_epi64( mid, 32 ) ),
+		_mm512_add_epi64( _mm512_srli_epi64( p01, 32 ), _mm512_srli_epi64( p10, 32 ) ) );
+}
+
+static inline LANES_AVX512 __m512i MulLo64x8( __m512i a, __m512i b ) {
+	__m512i cross = _mm512_add_epi64( _mm512_mul_epu32( a, _mm512_srli_epi64( b, 32 ) ),
+		_mm512_mul_epu32( _mm512_srli_epi64( a, 32 ), b ) );
+	return _mm512_add_epi64( _mm512_mul_epu32( a, b ), _mm512_slli_epi64( cross, 32 ) );
+}
+
+static inline LANES_AVX512 __m512i MontMul8( __m512i a, __m512i b, __m512i m, __m512i minv ) {
+	__m512i hi, lo, h, dummy;
+	Mul128x8( a, b, hi, lo );
+	Mul128x8( MulLo64x8( lo, minv ), m, h, dummy );
+	__mmask8 borrow = _mm512_cmplt_epu64_mask( hi, h );
+	__m512i r = _mm512_sub_epi64( hi, h );
+	return _mm512_mask_add_epi64( r, borrow, r, m );
+}
+
+// Eight lanes from i, moduli below 2^63: 64 x 64 -> 128 bit products from four
+// 32 x 32 -> 64 bit multiplies
+static LANES_AVX512 void PowLanesAvx512( U64 *r, const U64 *b, const U64 *e, const MontLanes &L, SizeType i ) {
+	const __m512i one64 = _mm512_set1_epi64( 1 );
+	__m512i m = _mm512_loadu_si512( &L.m[i] );
+	__m512i minv = _mm512_loadu_si512( &L.minv[i] );
+	__m512i ev = _mm512_loadu_si512( &e[i] );
+	__m512i x = MontMul8( _mm512_loadu_si512( &b[i] ), _mm512_loadu_si512( &L.r2[i] ), m, minv );
+	__m512i acc = _mm512_loadu_si512( &L.one[i] );
+	U64 emax = 0;
+	for ( int j = 0; j < 8; j++ ) emax |= e[i+j];
+	for ( ; emax; emax >>= 1 ) {
+		__m512i y = MontMul8( acc, x, m, minv );
+		acc = _mm512_mask_blend_epi64( _mm512_test_epi64_mask( ev, one64 ), acc, y );
+		x = MontMul8( x, x, m, minv );
+		ev = _mm512_srli_epi64( ev, 1 );
+	}
+	_mm512_storeu_si512( &r[i], MontMul8( acc, one64, m, minv ) );
+}
+
+static inline LANES_AVX512 __m512i MontMul32x8( __m512i a, __m512i b, __m512i m, __m512i minv ) {
+	__m512i t = _mm512_mul_epu32( a, b );
+	__m512i qm = _mm512_mul_epu32( _mm512_mul_epu32( t, minv ), m );
+	__m512i th = _mm512_srli_epi64( t, 32 ), qh = _mm512_srli_epi64( qm, 32 );
+	__m512i r = _mm512_sub_epi64( th, qh );
+	return _mm512_mask_add_epi64( r, _mm512_cmplt_epu64_mask( th, qh ), r, m );
+}
+
+// Eight lanes from i, all moduli below 2^32
+static LANES_AVX512 void PowLanes32Avx512( U64 *r, const U64 *b, const U64 *e, const MontLanes &L, SizeType i ) {
+	const __m512i one64 = _mm512_set1_epi64( 1 );
+	__m512i m = _mm512_loadu_si512( &L.m[i] );
+	__m512i minv = _mm512_loadu_si512( &L.minv[i] );
+	__m512i rr = _mm512_loadu_si512( &L.one[i] );
+	__m512i ev = _mm512_loadu_si512( &e[i] );
+	__m512i x = MontMul32x8( _mm512_loadu_si512( &b[i] ), rr, m, minv );
+	__m512i acc = MontMul32x8( one64, rr, m, minv );
+	U64 emax = 0;
+	for ( int j = 0; j < 8; j++ ) emax |= e[i+j];
+	for ( ; emax; emax >>= 1 ) {
+		__m512i y = MontMul32x8( acc, x, m, minv );
+		acc = _mm512_mask_blend_epi64( _mm512_test_epi64_mask( ev, one64 ), acc, y );
+		x = MontMul32x8( x, x, m, minv );
+		ev = _mm512_srli_epi64( ev, 1 );
+	}
+	_mm512_storeu_si512( &r[i], MontMul32x8( acc, one64, m, minv ) );
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+// Instruction set of the lane kernels: 0 scalar, 1 AVX2, 2 AVX-512
+// ( detected once, LanesIsaForced() >= 0 forces a choice )
+inline int &LanesIsaForced() {
+	static int isa = -1;
+	return isa;
+}
+
+static int DetectLanesIsa() {
+	int isa = 0;
+#ifdef LANES_X86
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) isa = 1;
+	if ( __builtin_cpu_supports( "avx512f" ) ) isa = 2;
+#endif
+	return isa;
+}
+
+static int LanesIsa() {
+	static const int detected = DetectLanesIsa();
+	int forced = LanesIsaForced();
+	return ( forced >= 0 )?forced:detected;
+}
+
+// Largest modulus of the lanes [i, i + w)
+static inline U64 LanesMax( const MontLanes &L, SizeType i, int w ) {
+	U64 mx = 0;
+	for ( int j = 0; j < w; j++ ) mx |= L.m[i+j];
+	return mx;
+}
+
+// r[i] = b[i]^e[i] mod L.m[i] for 0 <= i < L.Size(), b[i] < L.m[i]
+// Groups of lanes go to the widest kernel for their moduli: AVX-512 for any
+// modulus, AVX2 only below 2^32 ( the emulated 64-bit product is not faster
+// than the scalar code on four lanes ), everything else and the tail is scalar
+// ( lanes of similar size waste the fewest steps )
+inline void PowLanes( U64 *r, const U64 *b, const U64 *e, const MontLanes &L ) {
+	SizeType n = L.Size(), i = 0;
+#ifdef LANES_X86
+	int isa = LanesIsa();
+	int w = ( isa == 2 )?8:4;
+	for ( ; isa > 0 && i + w <= n; i += w ) {
+		bool narrow = ( LanesMax( L, i, w ) >> 32 ) == 0;
+		if ( isa == 2 && narrow ) PowLanes32Avx512( r, b, e, L, i );
+		else if ( isa == 2 ) PowLanesAvx512( r, b, e, L, i );
+		else if ( narrow ) PowLanes32Avx2( r, b, e, L, i );
+		else PowLanesScalar( r, b, e, L, i, i + w );
+	}
+#endif
+	PowLanesScalar( r, b, e, L, i, n );
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*************************************************************************
+*
+* Header file Prefilter.h
+*	cheap rejection of candidates ahead of the witness rounds
+*	a wheel mod 2*3*5*7 followed by trial division by the small primes,
+*	multi limb candidates are reduced once per limb sized product of primes
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#include "Limb.h"
+#include "BigInt.h"
+#include "FixedInt.h"
+#include "PrimeSieve.h"
+
+const DatType PREFILTER_WHEEL = 2 * 3 * 5 * 7;
+const DatType PREFILTER_PRIME_LIMIT = 1 << 15;	// 3512 primes
+
+// wheel = false and primeLimit = 0 turn the stage off
+struct PrefilterConfig {
+	bool wheel;		// reject multiples of 2, 3, 5 and 7 by the residue mod 210
+	DatType primeLimit;	// trial division by the primes below this bound
+
+	PrefilterConfig( bool w = true, DatType limit = PREFILTER_PRIME_LIMIT ):wheel(w),primeLimit(limit) {};
+};
+
+// Counters of the candidates ( >= 2 ) seen by a prefilter, updated concurrently
+struct PrefilterStats {
+	std::atomic<uint64_t> tested;	// candidates seen
+	std::atomic<uint64_t> wheel;	// rejected by the wheel
+	std::atomic<uint64_t> trial;	// rejected by a small prime factor
+	std::atomic<uint64_t> proven;	// decided prime ( small primes, or no factor below the square root )
+
+	PrefilterStats():tested(0),wheel(0),trial(0),proven(0) {};
+	uint64_t Passed() const { return tested - wheel - trial - proven; };
+	void Reset() { tested = 0; wheel = 0; trial = 0; proven = 0; };
+};
+
+inline std::ostream &operator<<( std::ostream &out, const PrefilterStats &s ) {
+	out << "tested " << s.tested << ", wheel " << s.wheel << ", trial " << s.trial
+		<< ", proven " << s.proven << ", passed " << s.Passed();
+	return out;
+}
+
+// Odd trial prime with the constants of the division free divisibility test:
+// p | x iff x * p^(-1) mod 2^k <= ( 2^k - 1 ) / p
+struct PrefilterPrime {
+	uint64_t p;
+	uint64_t inv;		// p^(-1) mod 2^64, its low half is the inverse mod 2^32
+	uint64_t max64;		// ( 2^64 - 1 ) / p
+	LimbType maxLimb;	// LIMB_MAX / p
+};
+
+static inline bool Divides64( uint64_t x, const PrefilterPrime &q ) {
+	return x * q.inv <= q.max64;
+}
+
+static inline bool DividesLimb( LimbType x, const PrefilterPrime &q ) {
+	return (LimbType)( x * (LimbType)q.inv ) <= q.maxLimb;
+}
+
+struct Prefilter {
+	PrefilterConfig config;
+	std::vector<char> coprime;		// coprime[r] = 1 iff gcd( r, 210 ) = 1
+	std::vector<PrefilterPrime> primes;	// odd trial primes ( from 11 behind the wheel ) in order
+	std::vector<LimbType> products;		// products of consecutive trial primes, each fits a limb
+	std::vector<SizeType> groupEnd;		// primes[groupEnd[g-1], groupEnd[g]) divide products[g]
+	uint64_t bound;				// smallest prime that is not tried
+	PrefilterStats stats;
+
+	Prefilter( const PrefilterConfig &cfg = PrefilterConfig() ) { Configure( cfg ); };
+
+	void Configure( const PrefilterConfig &cfg );
+
+	// -1 for n composite ( or n < 2 ), 1 for n prime, 0 when undecided
+	int Test( DatType n );
+	int Test( const BigInt &n );
+	template <int Bits> int Test( const FixedInt<Bits> &n );
+
+	bool Enabled() const { return config.wheel || config.primeLimit > 0; };
+	int TestWord( uint64_t n );
+	int TestLimbs( const LimbType *a, SizeType size );
+	int Proven() { stats.proven++; return 1; };
+	int Rejected( std::atomic<uint64_t> &counter ) { counter++; return -1; };
+};
+
+// Rebuild the tables for cfg, the statistics restart from zero
+inline void Prefilter::Configure( const PrefilterConfig &cfg ) {
+	config = cfg;
+	coprime.assign( PREFILTER_WHEEL, 0 );
+	for ( DatType r = 0; r < PREFILTER_WHEEL; r++ )
+		coprime[r] = ( r % 2 != 0 ) && ( r % 3 != 0 ) && ( r % 5 != 0 ) && ( r % 7 != 0 );
+
+	DatType first = config.wheel?11:3;
+	std::vector<DatType> small = SmallPrimes( ( config.primeLimit > first )?config.primeLimit:0 );
+	primes.clear();
+	products.clear();
+	groupEnd.clear();
+	LimbType prod = 1;
+	for ( size_t k = 0; k < small.size(); k++ ) {
+		uint64_t p = small[k];
+		if ( (DatType)p < first ) continue;
+		PrefilterPrime q;
+		q.p = p;
+		q.inv = p;
+		for ( int i = 0; i < 5; i++ ) q.inv *= 2 - p * q.inv;
+		q.max64 = ~(uint64_t)0 / p;
+		q.maxLimb = LIMB_MAX / (LimbType)p;
+		if ( prod > LIMB_MAX / (LimbType)p ) {
+			products.push_back( prod );
+			groupEnd.push_back( primes.size() );
+			prod = 1;
+		}
+		prod *= (LimbType)p;
+		primes.push_back( q );
+	}
+	if ( prod > 1 ) {
+		products.push_back( prod );
+		groupEnd.push_back( primes.size() );
+	}
+	bound = ( config.primeLimit > first )?config.primeLimit:first;
+	stats.Reset();
+}
+
+// Single word candidates are divided by every trial prime, without a
+// division, until the prime exceeds the square root
+inline int Prefilter::TestWord( uint64_t n ) {
+	if ( n < 2 ) return -1;
+	stats.tested++;
+	if ( config.wheel ) {
+		if ( !coprime[n % PREFILTER_WHEEL] ) {
+			if ( n == 2 || n == 3 || n == 5 || n == 7 ) return Proven();
+			return Rejected( stats.wheel );
+		}
+	} else if ( n % 2 == 0 ) {
+		if ( n == 2 ) return Proven();
+		return Rejected( stats.trial );
+	}
+	for ( size_t k = 0; k < primes.size(); k++ ) {
+		const PrefilterPrime &q = primes[k];
+		if ( q.p * q.p > n ) return Proven();
+		if ( Divides64( n, q ) ) return ( n == q.p )?Proven():Rejected( stats.trial );
+	}
+	if ( n / bound < bound ) return Proven();
+	return 0;
+}
+
+inline int Prefilter::Test( DatType n ) {
+	if ( n < 2 ) return -1;
+	if ( !Enabled() ) return 0;
+	return TestWord( (uint64_t)n );
+}
+
+// Candidates of more than 64 bits cost one pass over their limbs for the wheel
+// and one per limb sized product of trial primes, each prime of the product is
+// then tried on the single limb remainder
+// a[0..size) is a normalized magnitude
+inline int Prefilter::TestLimbs( const LimbType *a, SizeType size ) {
+	if ( !Enabled() ) return 0;
+	if ( size == 0 || size * LIMB_BITS - LimbClz( a[size-1] ) <= 64 ) {
+		return TestWord( LimbToU64( a, size ) );
+	}
+	stats.tested++;
+	if ( config.wheel ) {
+		if ( !coprime[LimbMod1( a, size, PREFILTER_WHEEL )] ) return Rejected( stats.wheel );
+	} else if ( a[0] % 2 == 0 ) {
+		return Rejected( stats.trial );
+	}
+	SizeType k = 0;
+	for ( size_t g = 0; g < products.size(); g++ ) {
+		LimbType r = LimbMod1( a, size, products[g] );
+		for ( ; k < groupEnd[g]; k++ ) {
+			if ( DividesLimb( r, primes[k] ) ) return Rejected( stats.trial );
+		}
+	}
+	return 0;
+}
+
+inline int Prefilter::Test( const BigInt &n ) {
+	if ( n.sign <= 0 ) return -1;
+	return TestLimbs( n.limbs.data(), n.size );
+}
+
+template <int Bits>
+int Prefilter::Test( const FixedInt<Bits> &n ) {
+	SizeType size = LimbNormSize( n.limb, FixedInt<Bits>::LIMBS );
+	if ( size == 0 ) return -1;
+	return TestLimbs( n.limb, size );
+}
+
+// Prefilter in front of SolovayStrassen, SetPrefilter must not run while tests do
+inline Prefilter &GlobalPrefilter() {
+	static Prefilter filter;
+	return filter;
+}
+
+inline void SetPrefilter( const PrefilterConfig &config ) {
+	GlobalPrefilter().Configure( config );
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*************************************************************************
+*
+* Header file PrimeSearch.h
+*	next prime and random prime search: the residues of the candidate
+*	modulo the small primes are computed once and advanced window by
+*	window, only the sieve survivors reach the probabilistic test
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef PRIMESEARCH_H
+#define PRIMESEARCH_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "ProbablePrime.h"
+#include "PrimeSieve.h"
+
+const DatType SEARCH_PRIME_MIN = 1 << 10;
+const DatType SEARCH_PRIME_MAX = 1 << 22;	// about 3*10^5 primes
+
+// Odd primes below SEARCH_PRIME_MAX, built once
+inline const std::vector<DatType> &SearchPrimes() {
+	static const std::vector<DatType> table = [] {
+		std::vector<DatType> all = SmallPrimes( SEARCH_PRIME_MAX );
+		return std::vector<DatType>( all.begin() + 1, all.end() );
+	}();
+	return table;
+}
+
+// Sieving bound for candidates of the given size: a deeper sieve costs one
+// residue per prime and saves exponentiations, whose cost grows with the size
+static inline DatType SearchPrimeLimit( SizeType bits ) {
+	DatType limit = (DatType)bits * bits;
+	return std::min( std::max( limit, SEARCH_PRIME_MIN ), SEARCH_PRIME_MAX );
+}
+
+// Probable primes in increasing order from a start value: the odd candidates
+// base + 2j, j < SIEVE_SEGMENT / 2, are sieved by the odd primes below the
+// bound using base mod p, then base moves on by SIEVE_SEGMENT and the
+// residues follow by one addition each
+template <typename T>
+struct PrimeSearch {
+	T base;				// odd start of the window
+	bool small;			// base below limit^2, no sieve ( a prime might mark itself )
+	PrimeTestMode mode;
+	DatType rounds;
+	DatType limit;			// sieving bound
+	SizeType count;			// sieving primes, the first ones of SearchPrimes()
+	std::vector<uint32_t> residues;	// base mod SearchPrimes()[k]
+	std::vector<char> composite;	// composite[j] = 1 iff base + 2j has a small factor
+	SizeType next;			// next j to look at
+	bool two;			// 2 is still to be returned
+	uint64_t sieved, tested;	// candidates seen by the sieve / by the probabilistic test
+
+	PrimeSearch( const T &from, PrimeTestMode m = BPSW, DatType s = 0 );
+
+	T Next();
+
+	void Prepare();
+	void Sieve();
+	void Advance();
+};
+
+template <typename T>
+PrimeSearch<T>::PrimeSearch( const T &from, PrimeTestMode m, DatType s ):
+	base(from),mode(m),rounds(s),count(0),next(0),two(false),sieved(0),tested(0) {
+	uint64_t w;
+	if ( CandidateWord( from, w ) && w <= 2 ) {
+		two = true;
+		base = 3;
+	}
+	if ( base % 2 == 0 ) base += 1;
+	limit = SearchPrimeLimit( CandidateBits( base ) );
+	small = CandidateWord( base, w ) && w < (uint64_t)( limit * limit );
+	composite.assign( SIEVE_SEGMENT / 2, 0 );
+	if ( !small ) Prepare();
+}
+
+// The residues of base, one multi limb division per product of primes below 2^62
+template <typename T>
+void PrimeSearch<T>::Prepare() {
+	const std::vector<DatType> &primes = SearchPrimes();
+	count = std::lower_bound( primes.begin(), primes.end(), limit ) - primes.begin();
+	residues.resize( count );
+	for ( SizeType k = 0; k < count; ) {
+		SizeType end = k;
+		DatType prod = 1;
+		while ( end < count && prod <= ( (DatType)1 << 62 ) / primes[end] ) prod *= primes[end++];
+		DatType r = base % prod;
+		for ( ; k < end; k++ ) residues[k] = (uint32_t)( r % primes[k] );
+	}
+	Sieve();
+}
+
+// Mark the window: base + 2j = 0 mod p for j = -r / 2 = ( p - r ) * ( p + 1 ) / 2 mod p
+template <typename T>
+void PrimeSearch<T>::Sieve() {
+	SizeType half = SIEVE_SEGMENT / 2;
+	const std::vector<DatType> &primes = SearchPrimes();
+	std::fill( composite.begin(), composite.end(), 0 );
+	for ( SizeType k = 0; k < count; k++ ) {
+		uint64_t p = primes[k];
+		uint64_t j = ( p - residues[k] ) % p * ( ( p + 1 ) / 2 ) % p;
+		for ( ; j < (uint64_t)half; j += p ) composite[j] = 1;
+	}
+}
+
+// Move the window by SIEVE_SEGMENT
+template <typename T>
+void PrimeSearch<T>::Advance() {
+	base += SIEVE_SEGMENT;
+	next = 0;
+	if ( small ) {
+		uint64_t w;
+		small = CandidateWord( base, w ) && w < (uint64_t)( limit * limit );
+		// first window past the bound
+		if ( !small ) Prepare();
+		return;
+	}
+	const std::vector<DatType> &primes = SearchPrimes();
+	for ( SizeType k = 0; k < count; k++ ) {
+		residues[k] = (uint32_t)( ( residues[k] + SIEVE_SEGMENT % primes[k] ) % primes[k] );
+	}
+	Sieve();
+}
+
+// Smallest probable prime >= from that was not returned yet
+template <typename T>
+T PrimeSearch<T>::Next() {
+	if ( two ) {
+		two = false;
+		return T( 2 );
+	}
+	SizeType half = SIEVE_SEGMENT / 2;
+	while ( true ) {
+		for ( ; next < half; next++ ) {
+			sieved++;
+			if ( !small && composite[next] ) continue;
+			T n = base + T( 2 * next );
+			tested++;
+			if ( ProbablePrimeRounds<T>( n, mode, rounds ) ) {
+				next++;
+				return n;
+			}
+		}
+		Advance();
+	}
+}
+
+// Smallest probable prime >= x
+template <typename T>
+T NextPrime( const T &x, PrimeTestMode mode = BPSW, DatType s = 0 ) {
+	PrimeSearch<T> search( x, mode, s );
+	return search.Next();
+}
+
+// Random probable prime of exactly bits bits, the next prime after a uniform
+// start ( primes after long gaps are a little more likely ), 0 for bits < 2
+inline BigInt RandomPrime( SizeType bits, PrimeTestMode mode = BPSW, DatType s = 0 ) {
+	if ( bits < 2 ) return BigInt();
+	BigInt top = BigInt( 1 ) << (DatType)( bits - 1 );
+	while ( true ) {
+		BigInt p = NextPrime<BigInt>( top + RandBigIntBelow( top ), mode, s );
+		if ( p.BitLength() == bits ) return p;
+	}
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*************************************************************************
+*
+* Header file PrimeSieve.h
+*	small primes and a segmented sieve of Eratosthenes
+*	used to filter ranges before the probabilistic test
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef PRIMESIEVE_H
+#define PRIMESIEVE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "Limb.h"
+
+const DatType SIEVE_SEGMENT = 1 << 15;		// numbers per segment, one byte each ( L1 cache )
+const DatType SIEVE_PRIME_LIMIT = 1 << 16;	// largest sieving prime
+
+// Primes below limit, plain sieve of Eratosthenes
+inline std::vector<DatType> SmallPrimes( DatType limit ) {
+	std::vector<char> composite( limit, 0 );
+	std::vector<DatType> primes;
+	for ( DatType i = 2; i < limit; i++ ) {
+		if ( composite[i] ) continue;
+		primes.push_back( i );
+		for ( DatType j = i * i; j < limit; j += i ) composite[j] = 1;
+	}
+	return primes;
+}
+
+// Sieve [lo, hi) with hi - lo <= flags.size(): flags[i] = 1 iff lo + i >= 2 and
+// lo + i has no factor among the primes smaller than itself
+// ( every prime survives, and so does a composite whose smallest factor is not in primes )
+inline void SieveSegment( std::vector<char> &flags, DatType lo, DatType hi, const std::vector<DatType> &primes ) {
+	DatType len = hi - lo;
+	std::fill( flags.begin(), flags.begin() + len, 1 );
+	for ( DatType i = lo; i < 2 && i < hi; i++ ) flags[i-lo] = 0;
+	for ( size_t k = 0; k < primes.size(); k++ ) {
+		DatType q = primes[k];
+		if ( q * q >= hi ) break;
+		DatType j = ( lo + q - 1 ) / q * q;
+		if ( j < q * q ) j = q * q;
+		for ( j -= lo; j < len; j += q ) flags[j] = 0;
+	}
+}
+
+#endif
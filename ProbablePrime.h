@@ -0,0 +1,407 @@
+/*************************************************************************
+*
+* Header file ProbablePrime.h
+*	Miller Rabin and Baillie-PSW tests next to Solovay Strassen, on the
+*	same modulus contexts, and the batch test of many candidates
+*		candidates below 2^64 are decided exactly by a table of bases
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef PROBABLEPRIME_H
+#define PROBABLEPRIME_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+
+#include "SolovayStrassen.h"
+
+// Error bound of s rounds: 2^-s for Solovay-Strassen, 4^-s for Miller-Rabin,
+// Baillie-PSW runs no random rounds and has no known counterexample
+enum PrimeTestMode { SOLOVAY_STRASSEN, MILLER_RABIN, BPSW };
+
+// Base sets that make the strong test exact below a bound: the one and two
+// base sets of the Miller-Rabin base search ( Sinclair, Steve Worley ), the
+// Jaeschke sets, Sinclair's seven bases up to 2^64
+// Bases are reduced mod n, a zero base is skipped
+struct WordBaseSet {
+	uint64_t bound;		// exact for n < bound ( 0 for 2^64 )
+	int count;
+	uint64_t bases[7];
+};
+
+const WordBaseSet WORD_BASE_SETS[] = {
+	{ 341531ULL, 1, { 9345883071009581737ULL } },
+	{ 1050535501ULL, 2, { 336781006125ULL, 9639812373923155ULL } },
+	{ 4759123141ULL, 3, { 2, 7, 61 } },
+	{ 1122004669633ULL, 4, { 2, 13, 23, 1662803 } },
+	{ 2152302898747ULL, 5, { 2, 3, 5, 7, 11 } },
+	{ 3474749660383ULL, 6, { 2, 3, 5, 7, 11, 13 } },
+	{ 0, 7, { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 } }
+};
+
+// Strong probable prime test of odd n > 2 to base a, n - 1 = d * 2^r with d odd
+static bool StrongWord( uint64_t n, const Montgomery64 &mont, uint64_t d, int r, uint64_t a ) {
+	U64 x = mont.Pow( a, d );
+	if ( x == 1 || x == n - 1 ) return true;
+	for ( int j = 1; j < r; j++ ) {
+		x = MulMod64( x, x, n );
+		if ( x == n - 1 ) return true;
+		if ( x == 1 ) return false;
+	}
+	return false;
+}
+
+// Deterministic primality of a single word, one strong test per base of the
+// smallest set whose bound exceeds n ( three for n < 4.7*10^9, at most seven )
+inline bool MillerRabinWord( uint64_t n ) {
+	if ( n < 4 ) return n >= 2;
+	if ( n % 2 == 0 ) return false;
+	uint64_t d = n - 1;
+	int r = __builtin_ctzll( d );
+	d >>= r;
+	Montgomery64 mont( n );
+	const WordBaseSet *set = WORD_BASE_SETS;
+	while ( set->bound != 0 && n >= set->bound ) set++;
+	for ( int k = 0; k < set->count; k++ ) {
+		uint64_t a = set->bases[k] % n;
+		if ( a == 0 ) continue;
+		if ( !StrongWord( n, mont, d, r, a ) ) return false;
+	}
+	return true;
+}
+
+// Value of a candidate that fits a word ( 0 for n <= 0 ), false for a larger one
+static inline bool CandidateWord( DatType n, uint64_t &w ) {
+	w = ( n > 0 )?(uint64_t)n:0;
+	return true;
+}
+
+static inline bool CandidateWord( const BigInt &n, uint64_t &w ) {
+	if ( n.sign <= 0 ) w = 0;
+	else if ( n.BitLength() <= 64 ) w = n.ToUint64();
+	else return false;
+	return true;
+}
+
+template <int Bits>
+static inline bool CandidateWord( const FixedInt<Bits> &n, uint64_t &w ) {
+	if ( n.BitLength() > 64 ) return false;
+	w = LimbToU64( n.limb, LimbNormSize( n.limb, FixedInt<Bits>::LIMBS ) );
+	return true;
+}
+
+// Bit length of a candidate, the batch tests large candidates first
+static inline SizeType CandidateBits( DatType n ) {
+	return ( n > 0 )?64 - __builtin_clzll( (unsigned long long)n ):0;
+}
+
+static inline SizeType CandidateBits( const BigInt &n ) {
+	return n.BitLength();
+}
+
+template <int Bits>
+static inline SizeType CandidateBits( const FixedInt<Bits> &n ) {
+	return n.BitLength();
+}
+
+static inline bool CandidateBit( DatType n, SizeType i ) {
+	return ( n >> i ) & 1;
+}
+
+template <typename T>
+static inline bool CandidateBit( const T &n, SizeType i ) {
+	return n.TestBit( i );
+}
+
+// Strong probable prime test of odd n > 2 to base a, n - 1 = d * 2^r with d odd
+// progress is handed to the exponentiation
+template <typename T>
+bool StrongRound( const T &n, const ModContext<T> &ctx, const T &d, DatType r, const T &a, PowProgress *progress = NULL ) {
+	T m = n - 1;
+	T x = ctx.Pow( a, d, progress );
+	if ( x == 1 || x == m ) return true;
+	for ( DatType j = 1; j < r; j++ ) {
+		x = ctx.Mul( x, x );
+		if ( x == m ) return true;
+		if ( x == 1 ) return false;
+	}
+	return false;
+}
+
+// n - 1 = d * 2^r with d odd, for odd n > 2
+template <typename T>
+DatType OddPart( const T &n, T &d ) {
+	DatType r = 0;
+	d = n - 1;
+	while ( d % 2 == 0 ) {
+		d /= 2;
+		r++;
+	}
+	return r;
+}
+
+// Residue arithmetic mod n for 0 <= a, b < n, no intermediate exceeds n
+// ( FixedInt wraps at 2^Bits )
+template <typename T>
+static inline T AddMod( const T &a, const T &b, const T &n ) {
+	T c = n - b;
+	return ( a >= c )?a - c:a + b;
+}
+
+template <typename T>
+static inline T SubMod( const T &a, const T &b, const T &n ) {
+	return ( a >= b )?a - b:a + ( n - b );
+}
+
+// a / 2 mod n for odd n
+template <typename T>
+static inline T HalfMod( const T &a, const T &n ) {
+	if ( a % 2 == 0 ) return a / 2;
+	return a / 2 + n / 2 + 1;
+}
+
+// v mod n as a residue for |v| < n
+template <typename T>
+static inline T SmallResidue( DatType v, const T &n ) {
+	if ( v >= 0 ) return T( v );
+	return n - T( -v );
+}
+
+// true iff n >= 0 is a perfect square, Newton iteration from above
+template <typename T>
+bool IsSquare( const T &n ) {
+	SizeType bits = CandidateBits( n );
+	if ( bits == 0 ) return true;
+	T x = T( 1 ) << (int)( ( bits + 1 ) / 2 );
+	T y = ( x + n / x ) / 2;
+	while ( y < x ) {
+		x = y;
+		y = ( x + n / x ) / 2;
+	}
+	return x * x == n;
+}
+
+// Strong Lucas probable prime test of odd n > 2^64 with Selfridge's parameters:
+// the first D of 5, -7, 9, -11, ... with (D/n) = -1, P = 1, Q = (1 - D) / 4
+// n + 1 = d * 2^r with d odd, n passes iff U_d = 0 or V_(d*2^j) = 0 for a j < r
+template <typename T>
+bool StrongLucas( const T &n, const ModContext<T> &ctx ) {
+	DatType D = 5;
+	for ( int tries = 0; ; tries++ ) {
+		T mag( ( D < 0 )?-D:D );
+		int jac = Jacobi<T>( mag, n );
+		if ( D < 0 ) jac *= Ep( n );
+		if ( jac == -1 ) break;
+		if ( jac == 0 && mag != n ) return false;
+		// no such D exists for a square
+		if ( tries == 16 && IsSquare( n ) ) return false;
+		D = ( D > 0 )?-D - 2:-D + 2;
+	}
+	T Dm = SmallResidue( D, n ), Q = SmallResidue( ( 1 - D ) / 4, n );
+
+	// ( n + 1 ) / 2 without overflowing a FixedInt
+	T d = n / 2 + 1;
+	DatType r = 1;
+	while ( d % 2 == 0 ) {
+		d /= 2;
+		r++;
+	}
+
+	// left-to-right over the bits of d: U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k,
+	// U_k+1 = ( U_k + V_k ) / 2, V_k+1 = ( D U_k + V_k ) / 2
+	T U = 1, V = 1, Qk = Q;
+	for ( SizeType i = CandidateBits( d ) - 2; i >= 0; i-- ) {
+		U = ctx.Mul( U, V );
+		V = SubMod( ctx.Mul( V, V ), AddMod( Qk, Qk, n ), n );
+		Qk = ctx.Mul( Qk, Qk );
+		if ( CandidateBit( d, i ) ) {
+			T u = HalfMod( AddMod( U, V, n ), n );
+			V = HalfMod( AddMod( ctx.Mul( Dm, U ), V, n ), n );
+			U = u;
+			Qk = ctx.Mul( Qk, Q );
+		}
+	}
+	if ( U == 0 || V == 0 ) return true;
+	for ( DatType j = 1; j < r; j++ ) {
+		V = SubMod( ctx.Mul( V, V ), AddMod( Qk, Qk, n ), n );
+		if ( V == 0 ) return true;
+		Qk = ctx.Mul( Qk, Qk );
+	}
+	return false;
+}
+
+// s Miller-Rabin rounds with random bases 2 <= a <= n - 2, without the prefilter
+// Candidates below 2^64 take the fixed bases instead and the answer is exact
+template <typename T>
+bool MillerRabinRounds( const T &n, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	uint64_t w;
+	if ( CandidateWord( n, w ) ) return MillerRabinWord( w );
+	if ( n % 2 == 0 ) return false;
+	ModContext<T> ctx( n );
+	T d;
+	DatType r = OddPart( n, d );
+	return RunRounds<T>( s, debug, pool, WitnessKey( n ), [&]( T &a, PowProgress *progress ) {
+		a = MakeRand<T>( n - 3 ) + 2;
+		return StrongRound<T>( n, ctx, d, r, a, progress );
+	} );
+}
+
+// Baillie-PSW: a strong test to base 2 followed by a strong Lucas test
+template <typename T>
+bool BpswTest( const T &n, bool debug = false ) {
+	uint64_t w;
+	if ( CandidateWord( n, w ) ) return MillerRabinWord( w );
+	if ( n % 2 == 0 ) return false;
+	ModContext<T> ctx( n );
+	T d;
+	DatType r = OddPart( n, d );
+	if ( !StrongRound<T>( n, ctx, d, r, T( 2 ) ) ) {
+		if ( debug ) std::cout << "Debug: Failed at a = 2" << std::endl;
+		return false;
+	}
+	if ( !StrongLucas<T>( n, ctx ) ) {
+		if ( debug ) std::cout << "Debug: Failed the strong Lucas test" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// The test of the given mode without the prefilter ( s is ignored by BPSW )
+template <typename T>
+bool ProbablePrimeRounds( const T &n, PrimeTestMode mode, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	if ( mode == MILLER_RABIN ) return MillerRabinRounds<T>( n, s, debug, pool );
+	if ( mode == BPSW ) return BpswTest<T>( n, debug );
+	return SolovayStrassenRounds<T>( n, s, debug, pool );
+}
+
+// Prime test of the given mode behind the prefilter
+// true for n ( probably ) prime, false for n composite
+template <typename T>
+bool ProbablePrime( const T &n, PrimeTestMode mode, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	Stopwatch watch( debug );
+
+	int pre = GlobalPrefilter().Test( n );
+	if ( pre < 0 ) return false;
+	if ( pre == 0 && !ProbablePrimeRounds<T>( n, mode, s, debug, pool ) ) return false;
+
+	// Calculate executed time
+	if ( debug ) std::cout << watch.Ms();
+
+	return true;
+}
+
+template <typename T>
+bool MillerRabin( const T &n, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	return ProbablePrime<T>( n, MILLER_RABIN, s, debug, pool );
+}
+
+template <typename T>
+bool Bpsw( const T &n, bool debug = false ) {
+	return ProbablePrime<T>( n, BPSW, 0, debug );
+}
+
+// Candidates per SIMD lane run of a long long batch
+const SizeType BATCH_LANE_CHUNK = 256;
+
+// Rounds for the undecided candidates of a batch ( in the given order )
+template <typename T>
+void BatchRounds( const T *candidates, const std::vector<SizeType> &order, PrimeTestMode mode, DatType s, char *verdict, ThreadPool *pool ) {
+	std::function<void( DatType )> body = [&]( DatType k ) {
+		SizeType i = order[k];
+		verdict[i] = ProbablePrimeRounds<T>( candidates[i], mode, s );
+	};
+	if ( pool ) pool->ParallelFor( order.size(), body );
+	else for ( size_t k = 0; k < order.size(); k++ ) body( k );
+}
+
+// long long candidates run in chunks through the SIMD lanes under Solovay-Strassen,
+// the other modes are exact for them
+inline void BatchRounds( const DatType *candidates, const std::vector<SizeType> &order, PrimeTestMode mode, DatType s, char *verdict, ThreadPool *pool ) {
+	if ( mode != SOLOVAY_STRASSEN ) {
+		BatchRounds<DatType>( candidates, order, mode, s, verdict, pool );
+		return;
+	}
+	DatType nchunk = ( order.size() + BATCH_LANE_CHUNK - 1 ) / BATCH_LANE_CHUNK;
+	std::function<void( DatType )> body = [&]( DatType c ) {
+		// the chunks follow the sorted order, the chunk index keys the witnesses
+		WitnessScope scope( c );
+		SizeType from = c * BATCH_LANE_CHUNK;
+		SizeType to = std::min<SizeType>( order.size(), from + BATCH_LANE_CHUNK );
+		std::vector<DatType> n( to - from );
+		std::vector<char> v( to - from );
+		for ( SizeType k = from; k < to; k++ ) n[k-from] = candidates[order[k]];
+		SolovayStrassenLanes( n.data(), to - from, s, v.data() );
+		for ( SizeType k = from; k < to; k++ ) verdict[order[k]] = v[k-from];
+	};
+	if ( pool ) pool->ParallelFor( nchunk, body );
+	else for ( DatType c = 0; c < nchunk; c++ ) body( c );
+}
+
+// Batch test of count candidates with the test of the given mode ( s rounds each )
+// Bit i of the returned bitmap is set iff candidates[i] is probably prime
+// One prefilter pass ( wheel and small primes ), then the undecided candidates
+// run largest first on the pool ( or on the calling thread without one ) so
+// that the long tests do not end up last on a single thread
+template <typename T>
+std::vector<uint64_t> ProbablePrimeBatch( const T *candidates, SizeType count, PrimeTestMode mode, DatType s, ThreadPool *pool = NULL ) {
+	std::vector<char> verdict( count, 0 );
+	std::vector<SizeType> order;
+	std::vector<SizeType> bits( count, 0 );
+	std::vector<signed char> pre( count );
+	std::function<void( DatType )> filter = [&]( DatType i ) { pre[i] = GlobalPrefilter().Test( candidates[i] ); };
+	if ( pool ) pool->ParallelFor( count, filter );
+	else for ( SizeType i = 0; i < count; i++ ) filter( i );
+	for ( SizeType i = 0; i < count; i++ ) {
+		int r = pre[i];
+		if ( r > 0 ) verdict[i] = 1;
+		if ( r == 0 ) {
+			order.push_back( i );
+			bits[i] = CandidateBits( candidates[i] );
+		}
+	}
+	std::stable_sort( order.begin(), order.end(), [&bits]( SizeType x, SizeType y ) { return bits[x] > bits[y]; } );
+
+	BatchRounds( candidates, order, mode, s, verdict.data(), pool );
+
+	std::vector<uint64_t> bitmap( ( count + 63 ) / 64, 0 );
+	for ( SizeType i = 0; i < count; i++ ) {
+		if ( verdict[i] ) bitmap[i/64] |= (uint64_t)1 << ( i % 64 );
+	}
+	return bitmap;
+}
+
+// Primes in the segment [lo, hi), hi - lo <= SIEVE_SEGMENT: the survivors of the
+// small primes sieve go through the test of the given mode
+inline DatType CountSegmentPrimes( DatType lo, DatType hi, const std::vector<DatType> &primes, PrimeTestMode mode, DatType s, bool use_big = false ) {
+	WitnessScope scope( lo );
+	std::vector<char> flags( SIEVE_SEGMENT );
+	SieveSegment( flags, lo, hi, primes );
+	std::vector<DatType> cand;
+	for ( DatType a = lo; a < hi; a++ ) {
+		if ( flags[a-lo] ) cand.push_back( a );
+	}
+	DatType cnt = 0;
+	if ( use_big ) {
+		for ( size_t i = 0; i < cand.size(); i++ ) cnt += ProbablePrime<BigInt>( BigInt( cand[i] ), mode, s );
+	} else if ( mode != SOLOVAY_STRASSEN ) {
+		for ( size_t i = 0; i < cand.size(); i++ ) cnt += ProbablePrime<DatType>( cand[i], mode, s );
+	} else {
+		// long long survivors run through the SIMD lanes together
+		std::vector<char> verdict( cand.size() );
+		SolovayStrassenLanes( cand.data(), cand.size(), s, verdict.data() );
+		for ( size_t i = 0; i < cand.size(); i++ ) cnt += verdict[i];
+	}
+	return cnt;
+}
+
+template <typename T>
+std::vector<uint64_t> SolovayStrassenBatch( const T *candidates, SizeType count, DatType s, ThreadPool *pool = NULL ) {
+	return ProbablePrimeBatch<T>( candidates, count, SOLOVAY_STRASSEN, s, pool );
+}
+
+#endif
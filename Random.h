@@ -0,0 +1,140 @@
+/*************************************************************************
+*
+* Header file Random.h
+*	per-thread seedable random generator for the test witnesses
+*	whole limbs are filled in bulk, uniform draws by rejection
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <random>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <ctime>
+#include <stdint.h>
+
+#include "Limb.h"
+
+// 0: seeded by the time, else reproducible
+inline std::atomic<uint64_t> &RandomSeed() {
+	static std::atomic<uint64_t> seed( 0 );
+	return seed;
+}
+
+// bumped by SetRandomSeed, threads reseed lazily
+inline std::atomic<unsigned> &RandomGeneration() {
+	static std::atomic<unsigned> generation( 0 );
+	return generation;
+}
+
+struct WitnessRng {
+	std::mt19937_64 engine;
+	unsigned generation;
+
+	WitnessRng():generation(~0u) {};
+
+	uint64_t Word() { return engine(); };
+	void Fill( LimbType *r, SizeType n );
+	DatType Below( DatType m );
+};
+
+// r[0..n) = random limbs, one engine call per 64 bits
+inline void WitnessRng::Fill( LimbType *r, SizeType n ) {
+#ifdef BIGINT_LIMB32
+	SizeType i = 0;
+	for ( ; i + 1 < n; i += 2 ) {
+		uint64_t w = engine();
+		r[i] = (LimbType)w;
+		r[i+1] = (LimbType)( w >> 32 );
+	}
+	if ( i < n ) r[i] = (LimbType)engine();
+#else
+	for ( SizeType i = 0; i < n; i++ ) r[i] = engine();
+#endif
+}
+
+// Uniform in [0, m) for m > 0, draws of the bit length of m are rejected when >= m
+inline DatType WitnessRng::Below( DatType m ) {
+	uint64_t mm = (uint64_t)m;
+	uint64_t mask = ~(uint64_t)0 >> __builtin_clzll( mm );
+	uint64_t w;
+	do {
+		w = engine() & mask;
+	} while ( w >= mm );
+	return (DatType)w;
+}
+
+// Reseed the generators of all threads ( at their next draw )
+// seed = 0 goes back to time based seeds, any other value makes the draws
+// reproducible: work items handed to threads draw inside a WitnessScope, whose
+// stream only depends on the seed and the item
+inline void SetRandomSeed( uint64_t seed ) {
+	RandomSeed() = seed;
+	RandomGeneration()++;
+}
+
+// Generator of the calling thread
+// With a seed every thread starts from the same stream, draws that must not
+// depend on the thread go through a WitnessScope
+inline WitnessRng &ThreadRng() {
+	static thread_local WitnessRng rng;
+	unsigned gen = RandomGeneration();
+	if ( rng.generation != gen ) {
+		uint64_t seed = RandomSeed();
+		if ( seed == 0 ) {
+			seed = (uint64_t)time( NULL ) ^ std::hash<std::thread::id>()( std::this_thread::get_id() );
+		}
+		std::seed_seq seq{ (uint32_t)seed, (uint32_t)( seed >> 32 ) };
+		rng.engine.seed( seq );
+		rng.generation = gen;
+	}
+	return rng;
+}
+
+// SplitMix64 finalizer, spreads nearby keys over the whole seed space
+static inline uint64_t MixKey( uint64_t x ) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebULL;
+	return x ^ ( x >> 31 );
+}
+
+// Draws of one work item ( a candidate and round, a segment, a chunk ): with a
+// seed set, the generator of the calling thread restarts from ( seed, item,
+// round ) for the lifetime of the scope and is restored afterwards, so that the
+// witnesses do not depend on which thread runs the item nor when
+// Without a seed the scope does nothing
+struct WitnessScope {
+	bool active;
+
+	WitnessScope( uint64_t item, uint64_t round = 0 );
+	~WitnessScope();
+
+	static std::vector<std::mt19937_64> &Saved() {
+		static thread_local std::vector<std::mt19937_64> saved;
+		return saved;
+	};
+};
+
+inline WitnessScope::WitnessScope( uint64_t item, uint64_t round ) {
+	uint64_t seed = RandomSeed();
+	active = ( seed != 0 );
+	if ( !active ) return;
+	WitnessRng &rng = ThreadRng();
+	Saved().push_back( rng.engine );
+	rng.engine.seed( MixKey( MixKey( MixKey( seed ) ^ item ) ^ round ) );
+}
+
+inline WitnessScope::~WitnessScope() {
+	if ( !active ) return;
+	ThreadRng().engine = Saved().back();
+	Saved().pop_back();
+}
+
+#endif
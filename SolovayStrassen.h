@@ -0,0 +1,396 @@
+/*************************************************************************
+*
+* Header file SolovayStrassen.h
+*	Solovay Strassen prime test for long long int and BigInt
+*		single candidates and SIMD lanes of long long candidates
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef SOLOVAYSTRASSEN_H
+#define SOLOVAYSTRASSEN_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+
+#include "BigInt.h"
+#include "Montgomery.h"
+#include "Montgomery64.h"
+#include "MontgomeryLanes.h"
+#include "Mersenne.h"
+#include "Gcd.h"
+#include "PrimeSieve.h"
+#include "Prefilter.h"
+#include "ThreadPool.h"
+#include "Stopwatch.h"
+
+// Return the epsilon function
+// jacobi symbol value in the special case (-1/n) = (-1)^((n-1)/2)
+// suppose for a positive odd integer n
+template <typename T>
+static inline int Ep( T n ) {
+	if ( n % 4 == 1 ) return 1;
+	return -1;
+}
+
+// Return the omega function
+// jacobi symbol value in the special calse  (2/n) = (-1)^((n^2-1)/8)
+template <typename T>
+static inline int Omega( T n ) {
+	if ( n % 8 == 1 || n % 8 == 7 ) return 1;
+	return -1;
+}
+
+// Return the theta function
+// for two positive odd integers m and n which are relatively prime
+template <typename T>
+static inline int Theta( T m, T n ) {
+	if ( m % 4 == 1 || n % 4 == 1 ) return 1;
+	return -1;
+}
+
+// Return the jacobi symbol (a/b) value
+// Suppose that b is an odd integer >= 3
+template <typename T>
+int Jacobi( T a, T b ) {
+	int result = 1;
+	T tmp;
+	if ( a >= 0 ) {
+		result = 1;
+	}
+	else {
+		a = -a;
+		result = Ep(b);
+	}
+	while ( a != 1 && a != 0 ) {
+		if ( a % 2 == 0 ) {
+			a /= 2;
+			result *= Omega( b );
+		} else {
+			result *= Theta( a, b );
+			tmp = a;
+			a = b % a;
+			b = tmp;
+		}
+	}
+	if ( a == 1 ) return result;
+	else return 0;
+}
+
+// Return the gcd of (a,b)
+// Suppose that a and b are non negative integers
+template <typename T>
+T Gcd( T a, T b ){
+	T min = (a > b)?b:a;
+	T max = (a > b)?a:b;
+	T tmp, rs = 0;
+	while ( min > 1 ){
+		tmp = min;
+		min = max % tmp;
+		max = tmp;
+	}
+	if ( min == 0 ) return max;
+	if ( min == 1 ) return min;
+	return rs;
+}
+
+// Lehmer and binary kernels of Gcd.h for BigInt
+template <>
+inline int Jacobi<BigInt>( BigInt a, BigInt b ) {
+	return BigJacobi( a, b );
+}
+
+template <>
+inline BigInt Gcd<BigInt>( BigInt a, BigInt b ) {
+	return BigGcd( a, b );
+}
+
+// Binary word kernels for long long, no division
+template <>
+inline int Jacobi<DatType>( DatType a, DatType b ) {
+	int result = 1;
+	if ( a < 0 ) {
+		a = -a;
+		result = Ep( b );
+	}
+	return result * JacobiWord( (uint64_t)a, (uint64_t)b );
+}
+
+template <>
+inline DatType Gcd<DatType>( DatType a, DatType b ) {
+	return (DatType)GcdWord( (uint64_t)( ( a < 0 )?-a:a ), (uint64_t)( ( b < 0 )?-b:b ) );
+}
+
+// Power module b^e mod m, square-and-multiply with a full reduction per step
+// suppose s >= 0, a > 0, n > 0
+template <typename T>
+T PowerModuleBasic( T b, T e, T m ) {
+	T id = 1;
+	if ( e == 0 ) return id;
+	b = b % m;
+	if ( e == 1 || b == 0 ) return b;
+	T result = id;
+	while ( e > 0 ) {
+		if ( e % 2 != 0 ) {
+			result *= b;
+			result %= m;
+		}
+		e /= 2;
+		b *= b;
+		b %= m;
+	}
+	return result;
+}
+
+// Modulus context: precomputed once per modulus and shared by all witness rounds
+// Pow( b, e ) = b^e mod m, Mul( a, b ) = a * b mod m for 0 <= a, b < m
+template <typename T>
+struct ModContext {
+	T m;
+	ModContext( T n ):m(n) {};
+	T Pow( T b, T e, PowProgress * = NULL ) const { return PowerModuleBasic<T>( b, e, m ); }
+	T Mul( const T &a, const T &b ) const { return ( a * b ) % m; }
+};
+
+// long long moduli use 128-bit products, Montgomery reduction for odd moduli
+// ( ( result * b ) % m overflows once m exceeds about 3*10^9 ), the progress
+// of Pow is not followed by the word and fixed width contexts
+template <>
+struct ModContext<DatType> {
+	DatType m;
+	Montgomery64 mont;
+	ModContext( DatType n ):m(n),mont( ( n > 0 && n % 2 != 0 )?n:1 ) {};
+	DatType Mul( DatType a, DatType b ) const { return (DatType)MulMod64( a, b, m ); }
+	DatType Pow( DatType b, DatType e, PowProgress * = NULL ) const {
+		if ( e == 0 ) return 1;
+		if ( e < 0 || m <= 0 ) return PowerModuleBasic<DatType>( b, e, m );
+		b %= m;
+		if ( b < 0 ) b += m;
+		if ( m % 2 != 0 ) return (DatType)mont.Pow( b, e );
+		U64 result = 1, x = b;
+		while ( e > 0 ) {
+			if ( e % 2 != 0 ) result = MulMod64( result, x, m );
+			e = e / 2;
+			x = MulMod64( x, x, m );
+		}
+		return (DatType)( result % m );
+	}
+};
+
+// BigInt moduli of the form 2^p - 1 reduce by shift and add, other odd
+// moduli use Montgomery multiplication, no division per step in both cases
+template <>
+struct ModContext<BigInt> {
+	BigInt m;
+	MersenneMod mers;
+	Montgomery mont;
+	ModContext( BigInt n ):m(n),mers( MersenneExponent( n ) ),mont( mers.n?BigInt():n ) {};
+	BigInt Mul( const BigInt &a, const BigInt &b ) const { return ( a * b ) % m; }
+	// progress ( resumable or stoppable exponentiation ) is only followed for odd moduli
+	BigInt Pow( const BigInt &b, const BigInt &e, PowProgress *progress = NULL ) const {
+		if ( e.sign < 0 ) return PowerModuleBasic<BigInt>( b, e, m );
+		if ( mers.n ) return mers.Pow( b, e, progress );
+		if ( mont.n ) return mont.Pow( b, e, progress );
+		return PowerModuleBasic<BigInt>( b, e, m );
+	}
+};
+
+// Fixed width moduli use the unrolled Montgomery kernel of FixedInt.h when odd,
+// even moduli square and multiply through double width products
+template <int Bits>
+struct ModContext< FixedInt<Bits> > {
+	typedef FixedInt<Bits> Int;
+	Int m;
+	FixedMontgomery<Bits> mont;
+	ModContext( const Int &n ):m(n),mont(n) {};
+	Int Mul( const Int &a, const Int &b ) const { return MulMod( a, b, m ); }
+	Int Pow( Int b, Int e, PowProgress * = NULL ) const {
+		if ( mont.odd ) return mont.Pow( b, e );
+		Int result = 1;
+		b %= m;
+		for ( SizeType i = e.BitLength() - 1; i >= 0; i-- ) {
+			result = MulMod( result, result, m );
+			if ( e.TestBit( i ) ) result = MulMod( result, b, m );
+		}
+		return result % m;
+	}
+};
+
+// Power module b^e mod m
+template <typename T>
+T PowerModule( T b, T e, T m ) {
+	ModContext<T> ctx( m );
+	return ctx.Pow( b, e );
+}
+
+// Exponential module a^((n-1)/2) mod n
+template <typename T>
+T ExpModule( const T &a, const T &n, const ModContext<T> &ctx, PowProgress *progress = NULL ) {
+	if ( n % 2 != 0) return ctx.Pow( a, (n-1)/2, progress );
+	return 0;
+}
+
+template <typename T>
+T ExpModule( T a, T n ) {
+	ModContext<T> ctx( n );
+	return ExpModule<T>( a, n, ctx );
+}
+
+// Make random number from 0 to (m-1)
+// other types than long long and BigInt provide RandBelow ( FixedInt )
+template <typename T>
+T MakeRand( T m ){
+	return RandBelow( m );
+}
+
+template<> inline DatType MakeRand<DatType>( DatType m ){
+	return ThreadRng().Below( m );
+}
+
+template<> inline BigInt MakeRand<BigInt>( BigInt m ){
+	return RandBigIntBelow( m );
+}
+
+// Key of a candidate for its witness streams ( see WitnessScope ): n modulo a
+// prime below 2^32, a single limb remainder for every type
+const DatType WITNESS_KEY_PRIME = 4294967291LL;
+
+template <typename T>
+uint64_t WitnessKey( const T &n ) {
+	return (uint64_t)( n % WITNESS_KEY_PRIME );
+}
+
+// One Solovay-Strassen round with a random witness a, 1 <= a < n, gcd( a, n ) = 1
+// true if a^((n-1)/2) = (a/n) mod n, progress is handed to the exponentiation
+template <typename T>
+bool WitnessRound( const T &n, const ModContext<T> &ctx, T &a, PowProgress *progress = NULL ) {
+	T m = n - 1;
+	// (a/n) = 0 iff gcd( a, n ) > 1, so the symbol also screens the witness
+	int jac;
+	do {
+		a = MakeRand<T>(m) + 1;
+		jac = Jacobi<T>( a, n );
+	} while ( jac == 0 );
+	T diff = ExpModule<T>( a, n, ctx, progress ) - jac;
+	return ( diff == 0 ) || ( diff == n );
+}
+
+// s rounds of a randomized test, round( a, progress ) draws a witness into a
+// and is false once that witness proves n composite; round j draws in the
+// WitnessScope( item, j ), item being the WitnessKey of the candidate
+// With a pool the s rounds run concurrently on its workers sharing one modulus
+// context; once a witness proves n composite the rounds not yet started are
+// skipped and the running ones leave their exponentiation ( progress->stop )
+template <typename T, typename Round>
+bool RunRounds( DatType s, bool debug, ThreadPool *pool, uint64_t item, const Round &round ) {
+	T a = 0;
+	bool composite = false;
+	if ( pool && pool->Size() > 1 && s > 1 ) {
+		std::atomic<bool> found( false );
+		pool->ParallelFor( s, [&]( DatType j ) {
+			if ( found ) return;
+			WitnessScope scope( item, j );
+			PowProgress progress;
+			progress.stop = &found;
+			T w;
+			// only the first failing round records its witness, a stopped
+			// round finds found already set
+			if ( !round( w, &progress ) && !found.exchange( true ) ) a = w;
+		} );
+		composite = found;
+	} else {
+		for ( int j = 0; j < s && !composite; j++ ) {
+			WitnessScope scope( item, j );
+			composite = !round( a, NULL );
+		}
+	}
+	if ( composite ) {
+		if ( debug ) {
+			std::cout << "Debug: Failed at a = " << a << std::endl;
+		}
+		return false;
+	}
+	return true;
+}
+
+// The s witness rounds of SolovayStrassen, without the prefilter
+template <typename T>
+bool SolovayStrassenRounds( const T &n, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	if ( n == 0 ) return false;
+	if ( n == 1 ) return false;
+	if ( n == 2 ) return true;
+	if ( n != 2 && n % 2 == 0 ) return 0;
+	ModContext<T> ctx( n );
+	return RunRounds<T>( s, debug, pool, WitnessKey( n ), [&]( T &a, PowProgress *progress ) { return WitnessRound<T>( n, ctx, a, progress ); } );
+}
+
+// Solovay_Strassen prime test
+// true for n prime, false for n composite
+// The prefilter ( see SetPrefilter ) decides most candidates before any round
+template <typename T>
+bool SolovayStrassen( T n, DatType s, bool debug = false, ThreadPool *pool = NULL ) {
+	Stopwatch watch( debug );
+
+	int pre = GlobalPrefilter().Test( n );
+	if ( pre < 0 ) return false;
+	if ( pre == 0 && !SolovayStrassenRounds<T>( n, s, debug, pool ) ) return false;
+	
+	// Calculate executed time
+	if ( debug ) std::cout << watch.Ms();
+
+	return true;
+}
+
+// s Solovay-Strassen rounds for count long long candidates at once, the
+// exponentiations of a round run in SIMD lanes ( PowLanes ), candidates drop
+// out of the lanes as soon as a witness proves them composite
+// verdict[i] = 1 iff n[i] is probably prime
+inline void SolovayStrassenLanes( const DatType *n, SizeType count, DatType s, char *verdict ) {
+	std::vector<SizeType> live;
+	MontLanes L;
+	for ( SizeType i = 0; i < count; i++ ) {
+		verdict[i] = ( n[i] == 2 );
+		if ( n[i] < 3 || n[i] % 2 == 0 ) continue;
+		verdict[i] = 1;
+		live.push_back( i );
+		L.Push( Montgomery64( n[i] ) );
+	}
+	std::vector<U64> b, e, r;
+	std::vector<int> jac;
+	for ( DatType j = 0; j < s && !live.empty(); j++ ) {
+		SizeType k = live.size();
+		b.resize( k );
+		e.resize( k );
+		r.resize( k );
+		jac.resize( k );
+		for ( SizeType t = 0; t < k; t++ ) {
+			// (a/x) = 0 iff gcd( a, x ) > 1, so the symbol also screens the witness
+			DatType x = n[live[t]], a;
+			do {
+				a = MakeRand<DatType>( x - 1 ) + 1;
+				jac[t] = Jacobi<DatType>( a, x );
+			} while ( jac[t] == 0 );
+			b[t] = a;
+			e[t] = ( x - 1 ) / 2;
+		}
+		PowLanes( r.data(), b.data(), e.data(), L );
+		SizeType w = 0;
+		for ( SizeType t = 0; t < k; t++ ) {
+			DatType diff = (DatType)r[t] - jac[t];
+			if ( diff != 0 && diff != n[live[t]] ) {
+				verdict[live[t]] = 0;
+				continue;
+			}
+			live[w] = live[t];
+			L.Move( w++, t );
+		}
+		live.resize( w );
+		L.Resize( w );
+	}
+}
+
+#endif
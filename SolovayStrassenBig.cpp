@@ -10,15 +10,32 @@
 *****************************************************************************/
 
 #include <iostream>
-#include <sys/time.h>
 #include <random>
+#include <string>
+#include <fstream>
+#include <atomic>
 
-#include "BigInt.h"
+#include "ProbablePrime.h"
+#include "PrimeSearch.h"
+#include "CandidateFile.h"
+#include "Checkpoint.h"
 
 const DatType NUMTEST = 25;
 const DatType MAXSIZE = 1000000;
 const DatType NUMSTATISTIC = 10;
 
+// Test of the range, mersen and batch commands ( --test ss|mr|bpsw )
+PrimeTestMode testMode = SOLOVAY_STRASSEN;
+
+// Checkpoint file of the range and mersen commands ( --checkpoint, empty for none )
+std::string checkpointPath;
+time_t checkpointInterval = CHECKPOINT_INTERVAL;
+
+// Rounds of the test mode for the error bound of NUMTEST Solovay-Strassen rounds
+DatType TestRounds() {
+	return ( testMode == MILLER_RABIN )?( NUMTEST + 1 ) / 2:NUMTEST;
+}
+
 // For generate Mersen prime numbers
 DatType p[] = { 2, 3, 5, 7, 13, 17, 19, 31, 61, 89, 
 	107, 127, 521, 607, 1279, 2203, 2281, 3217, 4253, 4423,
@@ -26,162 +43,6 @@ DatType p[] = { 2, 3, 5, 7, 13, 17, 19, 31, 61, 89,
 	132049, 216091, 756839, 859433, 1257787, 1398269, 2976221, 3021377, 6972593, 13466917,
 	20996011, 24036583, 25964951, 30402457, 32582657, 37156667, 42643801, 43112609, 57885161 };
 
-// Return the epsilon function
-// jacobi symbol value in the special case (-1/n) = (-1)^((n-1)/2)
-// suppose for a positive odd integer n
-template <typename T>
-static inline int Ep( T n ) {
-	if ( n % 4 == 1 ) return 1;
-	return -1;
-}
-
-// Return the omega function
-// jacobi symbol value in the special calse  (2/n) = (-1)^((n^2-1)/8)
-template <typename T>
-static inline int Omega( T n ) {
-	if ( n % 8 == 1 || n % 8 == 7 ) return 1;
-	return -1;
-}
-
-// Return the theta function
-// for two positive odd integers m and n which are relatively prime
-template <typename T>
-static inline int Theta( T m, T n ) {
-	if ( m % 4 == 1 || n % 4 == 1 ) return 1;
-	return -1;
-}
-
-// Return the jacobi symbol (a/b) value
-// Suppose that b is an odd integer >= 3
-template <typename T>
-int Jacobi( T a, T b ) {
-	int result = 1;
-	T tmp;
-	if ( a >= 0 ) {
-		result = 1;
-	}
-	else {
-		a = -a;
-		result = Ep(b);
-	}
-	while ( a != 1 && a != 0 ) {
-		if ( a % 2 == 0 ) {
-			a /= 2;
-			result *= Omega( b );
-		} else {
-			result *= Theta( a, b );
-			tmp = a;
-			a = b % a;
-			b = tmp;
-		}
-	}
-	if ( a == 1 ) return result;
-	else return 0;
-}
-
-// Return the gcd of (a,b)
-// Suppose that a and b are non negative integers
-template <typename T>
-T Gcd( T a, T b ){
-	T min = (a > b)?b:a;
-	T max = (a > b)?a:b;
-	T tmp, rs = 0;
-	while ( min > 1 ){
-		tmp = min;
-		min = max % tmp;
-		max = tmp;
-	}
-	if ( min == 0 ) return max;
-	if ( min == 1 ) return min;
-	return rs;
-}
-
-// Power module a^2 mod n
-// suppose s >= 0, a > 0, n > 0
-template <typename T>
-T PowerModule( T b, T e, T m ) {
-	T id = 1;
-	if ( e == 0 ) return id;
-	b = b % m;
-	if ( e == 1 || b == 0 ) return b;
-	T result = id;
-	while ( e > 0 ) {
-		if ( e % 2 != 0 ) {
-			result = (result * b) % m;
-		}
-		e = e / 2;
-		b = ( b * b ) % m;
-	}
-	return result;
-}
-
-// Exponential module a^((n-1)/2) mod n
-template <typename T>
-T ExpModule( T a, T n ) {
-	if ( n % 2 != 0) return PowerModule( a, (n-1)/2, n );
-	return 0;
-}
-
-// Make random number from 0 to (m-1)
-template <typename T>
-T MakeRand( T m ){
-	T rs = 0;
-	return rs;
-}
-
-template<> DatType MakeRand<DatType>( DatType m ){
-	DatType value = randomEngine();
-    DatType rs = value % m;
-	return rs;
-}
-
-template<> BigInt MakeRand<BigInt>( BigInt m ){
-	int sz = m.size;
-	BigInt tmp = m;
-	while ( tmp >= m ) {
-		tmp = RandBigIntSize( sz );
-	}
-	return tmp;
-}
-
-// Solovay_Strassen prime test
-// true for n prime, false for n composite
-template <typename T>
-bool SolovayStrassen( T n, DatType s, bool debug = false) {
-	struct timeval start, stop;
-	gettimeofday( &start, NULL );
-	
-	if ( n == 0 ) return false;
-	if ( n == 1 ) return false;
-	if ( n == 2 ) return true;
-	if ( n != 2 && n % 2 == 0 ) return 0;
-	srand( (unsigned) time(NULL) );
-	T m = n - 1;
-	for ( int j = 0; j < s; j++ ) {
-		T a = 0;
-		while ( Gcd( a, n) != 1 ){
-			a = MakeRand<T>(m) + 1;
-		}
-		T diff = ExpModule<T>( a, n ) - Jacobi<T>( a, n );
-		if ( (diff != 0) && (diff != n) ) {
-			if ( debug ) {
-				std::cout << "Debug: Failed at a = " << a << std::endl;
-			}
-			return false;
-		}
-	}
-	
-	// Calculate executed time
-	if ( debug ){
-		gettimeofday( &stop, NULL );
-		double start_mill = start.tv_sec * 1000.0 + (start.tv_usec) / 1000.0;
-		double stop_mill = stop.tv_sec * 1000.0 + (stop.tv_usec) / 1000.0;
-		std::cout << stop_mill - start_mill;
-	}
-
-	return true;
-}
-
 // Small test function code 
 template <typename T, typename K>
 int Test( T expected, K got ) {
@@ -201,8 +62,7 @@ DatType NumOfPrimeTest( DatType n, bool use_big = true, bool debug = false ) {
 	int s = NUMTEST;
 	DatType num = 0;
 
-	struct timeval start, stop;
-	gettimeofday( &start, NULL );
+	Stopwatch watch;
 
 	for ( DatType a = 1; a < n; a++ ){
 		bool rs = false;
@@ -219,13 +79,109 @@ DatType NumOfPrimeTest( DatType n, bool use_big = true, bool debug = false ) {
 	}
 	std::cout << num << ",";
 
-	gettimeofday( &stop, NULL );
-	double start_mill = start.tv_sec * 1000.0 + (start.tv_usec) / 1000.0;
-	double stop_mill = stop.tv_sec * 1000.0 + (stop.tv_usec) / 1000.0;
-	std::cout << stop_mill - start_mill << std::endl;
+	std::cout << watch.Ms() << std::endl;
 	return num;
 }
 
+// Parallel range test: count the primes in [lo, hi) on nthreads threads
+// ( 0 for all hardware threads ). The range is cut into SIEVE_SEGMENT sized
+// segments pulled by the threads from a shared cursor, each segment is sieved
+// by the small primes and only the survivors go through the test of testMode
+// With a checkpoint file the segments go in waves, the cursor ( segments done )
+// and the count so far are saved between waves; return -1 if the file is unusable
+DatType RangePrimeTest( DatType lo, DatType hi, int nthreads = 0, bool use_big = false, CheckpointFile *ck = NULL ) {
+	Stopwatch watch;
+
+	if ( lo < 0 ) lo = 0;
+	std::vector<DatType> primes = SmallPrimes( SIEVE_PRIME_LIMIT );
+	std::atomic<DatType> num( 0 );
+	DatType nseg = ( hi > lo )?( hi - lo + SIEVE_SEGMENT - 1 ) / SIEVE_SEGMENT:0;
+	DatType s = TestRounds();
+
+	DatType done = 0;
+	std::string key = "range " + std::to_string( lo ) + " " + std::to_string( hi ) + " "
+		+ std::to_string( (int)testMode ) + " " + std::to_string( s ) + ( use_big?" big":"" );
+	if ( ck ) {
+		CheckpointData data;
+		int loaded = ck->Load( data );
+		std::string k;
+		uint64_t cursor, count;
+		if ( loaded < 0 ) return -1;
+		if ( loaded > 0 ) {
+			if ( !data.GetString( k ) || k != key || !data.GetWord( cursor ) || !data.GetWord( count ) || cursor > (uint64_t)nseg ) {
+				ck->error = ck->path + " belongs to another job";
+				return -1;
+			}
+			done = cursor;
+			num = count;
+			std::cerr << "Resumed at segment " << done << " of " << nseg << std::endl;
+		}
+	}
+
+	ThreadPool pool( nthreads );
+	auto segment = [&]( DatType k ) {
+		DatType slo = lo + k * SIEVE_SEGMENT;
+		num += CountSegmentPrimes( slo, std::min( hi, slo + SIEVE_SEGMENT ), primes, testMode, s, use_big );
+	};
+	if ( ck == NULL ) pool.ParallelFor( nseg, segment );
+	else {
+		DatType wave = 64 * pool.Size();
+		while ( done < nseg ) {
+			DatType from = done, cnt = std::min( wave, nseg - done );
+			pool.ParallelFor( cnt, [&]( DatType j ) { segment( from + j ); } );
+			done += cnt;
+			if ( done < nseg && ck->Due() ) {
+				CheckpointData data;
+				data.PutString( key );
+				data.PutWord( done );
+				data.PutWord( num );
+				if ( !ck->Save( data ) ) std::cerr << ck->error << std::endl;
+				if ( CheckpointStop() ) ck->Stop();
+			}
+		}
+		ck->Remove();
+	}
+	std::cout << num << ",";
+
+	std::cout << watch.Ms() << std::endl;
+	return num;
+}
+
+// Certification of the deterministic word test: every n in [0, hi) is checked
+// against an exact segmented sieve ( sieving primes up to the square root of hi ),
+// return the number of disagreements
+DatType CertifyWordTest( DatType hi, int nthreads = 0 ) {
+	Stopwatch watch;
+
+	DatType root = 1;
+	while ( root * root < hi ) root++;
+	std::vector<DatType> primes = SmallPrimes( root + 1 );
+	std::atomic<DatType> num( 0 ), bad( 0 );
+	DatType nseg = ( hi + SIEVE_SEGMENT - 1 ) / SIEVE_SEGMENT;
+
+	ThreadPool pool( nthreads );
+	pool.ParallelFor( nseg, [&]( DatType k ) {
+		DatType slo = k * SIEVE_SEGMENT;
+		DatType shi = std::min( hi, slo + SIEVE_SEGMENT );
+		std::vector<char> flags( SIEVE_SEGMENT );
+		SieveSegment( flags, slo, shi, primes );
+		DatType cnt = 0, wrong = 0;
+		for ( DatType a = slo; a < shi; a++ ) {
+			bool prime = MillerRabinWord( (uint64_t)a );
+			if ( prime != ( flags[a-slo] != 0 ) ) {
+				if ( wrong++ == 0 ) std::cout << "Certify: wrong verdict for " << a << std::endl;
+			}
+			cnt += prime;
+		}
+		num += cnt;
+		bad += wrong;
+	} );
+	std::cout << num << "," << bad << ",";
+
+	std::cout << watch.Ms() << std::endl;
+	return bad;
+}
+
 // Run multi-times NumOfPrimeTest for statics
 bool StatisticNumOfPrimeTest( DatType n, bool use_big, DatType numt = NUMSTATISTIC, bool debug = false ) {
 	if ( use_big ) std::cout << "Using BigInt class " << std::endl;
@@ -252,24 +208,100 @@ T Power( T b, DatType e ){
 	return result;
 }
 
-// Mersen test: check Mersen prime number 
+// Mersen number 2^p - 1
+template <typename T>
+T MersenNumber( DatType pw ) {
+	return Power<T>( T(2), pw ) - 1;
+}
+
+template<> BigInt MersenNumber<BigInt>( DatType pw ) {
+	return ( BigInt(1) << pw ) - 1;
+}
+
+// Mersen test: check Mersen prime number
+// with lucas = true the deterministic Lucas-Lehmer test replaces Solovay-Strassen
 template <typename T>
-int MersenTest( int max_index, bool debug = true ){
+int MersenTest( int max_index, bool debug = true, bool lucas = false, ThreadPool *pool = NULL ){
 	int s = NUMTEST;
 	for ( int i = 0; i < max_index; ++i ){
-		T pw = Power<T>( T(2), p[i] ) - 1;
 		std::cout << std::endl << "Mersen number " << i+1 <<"th, p = " << p[i] << ", Executed time (ms): ";
-		SolovayStrassen<T>( pw, s, debug );
+		if ( lucas ) {
+			Stopwatch watch;
+			bool prime = LucasLehmer( p[i] );
+			std::cout << watch.Ms();
+			if ( !prime ) std::cout << " composite";
+			continue;
+		}
+		T pw = MersenNumber<T>( p[i] );
+		if ( testMode == SOLOVAY_STRASSEN ) SolovayStrassen<T>( pw, s, debug, pool );
+		else ProbablePrime<T>( pw, testMode, TestRounds(), debug, pool );
 	}
 	std::cout << std::endl;
 	return 1;
 }
 
+// Checkpointed Solovay-Strassen on the first Mersenne numbers: the checkpoint
+// holds the index of the current number and the state of its witness rounds
+// ( witness, exponent bit, accumulator ), return false if the file is unusable
+bool MersenResumable( int max_index, ThreadPool *pool, CheckpointFile &file ) {
+	std::string key = "mersen " + std::to_string( max_index ) + " " + std::to_string( NUMTEST );
+	uint64_t index = 0;
+	std::vector<RoundState> rounds( NUMTEST );
+	auto save = [&]() {
+		CheckpointData data;
+		data.PutString( key );
+		data.PutWord( index );
+		for ( size_t j = 0; j < rounds.size(); j++ ) rounds[j].Put( data );
+		if ( !file.Save( data ) ) std::cerr << file.error << std::endl;
+	};
+
+	CheckpointData data;
+	int loaded = file.Load( data );
+	if ( loaded < 0 ) return false;
+	if ( loaded > 0 ) {
+		std::string k;
+		bool ok = data.GetString( k ) && k == key && data.GetWord( index ) && index <= (uint64_t)max_index;
+		for ( size_t j = 0; ok && j < rounds.size(); j++ ) ok = rounds[j].Get( data );
+		if ( !ok ) {
+			file.error = file.path + " belongs to another job";
+			return false;
+		}
+		std::cout << "Resumed at Mersen number " << index + 1 << "th";
+	}
+
+	while ( index < (uint64_t)max_index ) {
+		std::cout << std::endl << "Mersen number " << index + 1 << "th, p = " << p[index] << ", Executed time (ms): ";
+		std::cout.flush();
+		Stopwatch watch;
+		BigInt n = MersenNumber<BigInt>( p[index] );
+		int pre = GlobalPrefilter().Test( n );
+		bool prime = ( pre > 0 ) || ( pre == 0 && ResumableRounds( n, rounds, pool, file, save ) );
+		std::cout << watch.Ms();
+		if ( !prime ) std::cout << " composite";
+
+		// next number from scratch
+		rounds.assign( NUMTEST, RoundState() );
+		index++;
+		save();
+		if ( CheckpointStop() ) file.Stop();
+	}
+	std::cout << std::endl;
+	file.Remove();
+	return true;
+}
+
 // Probability test: how many times for an composite n, the algorithm output 'non prime' result
 DatType ProbTest( DatType n, DatType num_test ) {
 	DatType num_comp = 0;
-	for ( DatType i = 0; i < num_test; i++ ) {
-		if ( !SolovayStrassen<DatType>(n,1) ) num_comp++;
+	// the single round tests are independent, they run side by side in SIMD lanes
+	std::vector<DatType> cand( BATCH_LANE_CHUNK, n );
+	std::vector<char> verdict( BATCH_LANE_CHUNK );
+	for ( DatType i = 0; i < num_test; i += BATCH_LANE_CHUNK ) {
+		SizeType k = std::min<DatType>( BATCH_LANE_CHUNK, num_test - i );
+		SolovayStrassenLanes( cand.data(), k, 1, verdict.data() );
+		for ( SizeType j = 0; j < k; j++ ) {
+			if ( !verdict[j] ) num_comp++;
+		}
 	}
 	return num_comp;
 }
@@ -288,10 +320,9 @@ bool StatisticProbTest( DatType num_test ) {
 
 // Small performance test
 double PerformanceTest( ) {
-	struct timeval start, stop;
-	gettimeofday( &start, NULL );
+	Stopwatch watch;
 
-	int sz = MAXSIZE;
+	SizeType sz = MAXSIZE / LIMB_DIGITS;
 	BigInt bg = RandBigIntSize( sz );
 	BigInt bg_r = MakeRand<BigInt>( bg );
 
@@ -301,15 +332,138 @@ double PerformanceTest( ) {
 	std::cout << "Jacobi: " << Jacobi<BigInt>( bg_r, bg ) << std::endl;
 	std::cout << "Exp: " << ExpModule<BigInt>( bg_r, bg ).size << std::endl;
 	
-	gettimeofday( &stop, NULL );
-	double start_mill = start.tv_sec * 1000.0 + (start.tv_usec) / 1000.0;
-	double stop_mill = stop.tv_sec * 1000.0 + (stop.tv_usec) / 1000.0;
-	return ( stop_mill - start_mill );
+	return watch.Ms();
 }
 
 // Main function
 int main( int argc, char* argv[] ) {
-	
+
+	// Options before any other argument: --seed <value> for reproducible
+	// witnesses, --test ss|mr|bpsw for the test of the commands, --checkpoint
+	// <file> [--checkpoint-interval <seconds>] to make range and mersen resumable
+	const char *prog = argv[0];
+	while ( argc > 2 ) {
+		std::string opt = argv[1];
+		if ( opt == "--seed" ) SetRandomSeed( strtoull( argv[2], NULL, 10 ) );
+		else if ( opt == "--checkpoint" ) checkpointPath = argv[2];
+		else if ( opt == "--checkpoint-interval" ) checkpointInterval = atoll( argv[2] );
+		else if ( opt == "--test" ) {
+			std::string t = argv[2];
+			if ( t == "mr" ) testMode = MILLER_RABIN;
+			else if ( t == "bpsw" ) testMode = BPSW;
+			else testMode = SOLOVAY_STRASSEN;
+		}
+		else break;
+		argc -= 2;
+		argv += 2;
+	}
+
+	// Command mode: range, mersen or batch ( see the usage line below )
+	if ( argc > 1 ) {
+		std::string cmd = argv[1];
+		if ( cmd == "range" && argc > 3 ) {
+			DatType lo = atoll( argv[2] ), hi = atoll( argv[3] );
+			int nthreads = ( argc > 4 )?atoi( argv[4] ):0;
+			bool use_big = ( argc > 5 && std::string( argv[5] ) == "big" );
+			CheckpointFile file( checkpointPath, checkpointInterval );
+			if ( !checkpointPath.empty() ) InstallCheckpointSignals();
+			std::cout << "Prime numbers in [" << lo << ", " << hi << "): ";
+			if ( RangePrimeTest( lo, hi, nthreads, use_big, checkpointPath.empty()?NULL:&file ) < 0 ) {
+				std::cerr << file.error << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+		if ( cmd == "nextprime" && argc > 2 ) {
+			// count probable primes from x on, BPSW unless --test says otherwise
+			PrimeTestMode mode = ( testMode == SOLOVAY_STRASSEN )?BPSW:testMode;
+			PrimeSearch<BigInt> search( BigInt( std::string( argv[2] ) ), mode, TestRounds() );
+			DatType count = ( argc > 3 )?atoll( argv[3] ):1;
+			for ( DatType i = 0; i < count; i++ ) std::cout << search.Next() << std::endl;
+			std::cerr << "Sieved " << search.sieved << ", tested " << search.tested << std::endl;
+			return 0;
+		}
+		if ( cmd == "randprime" && argc > 2 ) {
+			PrimeTestMode mode = ( testMode == SOLOVAY_STRASSEN )?BPSW:testMode;
+			SizeType bits = atoll( argv[2] );
+			if ( bits < 2 ) {
+				std::cerr << "Usage: " << prog << " randprime <bits> [count], with at least 2 bits" << std::endl;
+				return 1;
+			}
+			DatType count = ( argc > 3 )?atoll( argv[3] ):1;
+			for ( DatType i = 0; i < count; i++ ) std::cout << RandomPrime( bits, mode, TestRounds() ) << std::endl;
+			return 0;
+		}
+		if ( cmd == "certify" && argc > 2 ) {
+			// deterministic word test against the sieve, exit status 1 on any disagreement
+			DatType hi = atoll( argv[2] );
+			std::cout << "Deterministic test on [0, " << hi << ") ( primes, wrong, ms ): ";
+			return ( CertifyWordTest( hi, ( argc > 3 )?atoi( argv[3] ):0 ) == 0 )?0:1;
+		}
+		if ( cmd == "mersen" && argc > 2 ) {
+			// Solovay-Strassen on the first Mersenne primes, witness rounds in parallel
+			int count = std::min( atoi( argv[2] ), (int)( sizeof( p ) / sizeof( p[0] ) ) );
+			if ( count <= 0 ) {
+				std::cerr << "Usage: " << prog << " mersen <count> [threads], count from 1 to " << sizeof( p ) / sizeof( p[0] ) << std::endl;
+				return 1;
+			}
+			ThreadPool pool( ( argc > 3 )?atoi( argv[3] ):0 );
+			if ( !checkpointPath.empty() && testMode == SOLOVAY_STRASSEN ) {
+				CheckpointFile file( checkpointPath, checkpointInterval );
+				InstallCheckpointSignals();
+				if ( !MersenResumable( count, &pool, file ) ) {
+					std::cerr << file.error << std::endl;
+					return 1;
+				}
+				return 0;
+			}
+			if ( !checkpointPath.empty() ) std::cerr << "Checkpoints follow the Solovay-Strassen rounds only, running without" << std::endl;
+			MersenTest<BigInt>( count, true, false, &pool );
+			return 0;
+		}
+		if ( cmd == "batch" ) {
+			// decimal candidates from stdin, one verdict ( 1 probably prime, 0 composite ) per line
+			std::vector<BigInt> cand;
+			std::string line;
+			while ( std::cin >> line ) cand.push_back( BigInt( line ) );
+			ThreadPool pool( ( argc > 2 )?atoi( argv[2] ):0 );
+			std::vector<uint64_t> bitmap = ProbablePrimeBatch<BigInt>( cand.data(), cand.size(), testMode, TestRounds(), &pool );
+			for ( size_t i = 0; i < cand.size(); i++ ) std::cout << ( ( bitmap[i/64] >> ( i % 64 ) ) & 1 ) << std::endl;
+			std::cerr << "Prefilter: " << GlobalPrefilter().stats << std::endl;
+			return 0;
+		}
+		if ( cmd == "convert" && argc > 3 ) {
+			// decimal or 0x hexadecimal lines ( - for stdin ) to a binary candidate file
+			std::string error;
+			uint64_t count = 0;
+			std::ifstream file;
+			if ( std::string( argv[2] ) != "-" ) file.open( argv[2] );
+			if ( std::string( argv[2] ) != "-" && !file ) error = std::string( "cannot open " ) + argv[2];
+			else if ( ConvertCandidates( file.is_open()?file:std::cin, argv[3], count, error ) ) {
+				std::cout << "Converted " << count << " candidates" << std::endl;
+				return 0;
+			}
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		if ( cmd == "stream" && argc > 3 ) {
+			// mapped candidate file through the batch test, verdict bitmap to a file
+			ThreadPool pool( ( argc > 4 )?atoi( argv[4] ):0 );
+			std::string error;
+			uint64_t primes = 0;
+			Stopwatch watch;
+			if ( !StreamCandidates( argv[2], argv[3], testMode, TestRounds(), &pool, primes, error ) ) {
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			std::cout << "Probable primes: " << primes << " ( " << watch.Ms() << " ms )" << std::endl;
+			std::cerr << "Prefilter: " << GlobalPrefilter().stats << std::endl;
+			return 0;
+		}
+		std::cout << "Usage: " << prog << " [--seed <value>] [--test ss|mr|bpsw] [--checkpoint <file> [--checkpoint-interval <seconds>]] [range <lo> <hi> [threads] [big] | nextprime <x> [count] | randprime <bits> [count] | certify <hi> [threads] | mersen <count> [threads] | batch [threads] < candidates | convert <text> <binary> | stream <binary> <bitmap> [threads]]" << std::endl;
+		return 1;
+	}
+
 	// Test performance
 	// Find all prime number less than 10000, execute test for 10 times
 	
@@ -325,6 +479,10 @@ int main( int argc, char* argv[] ) {
 	std::cout << "Mersen prime number test with Big Int class type: " << std::endl;
 	MersenTest<BigInt>( 14 );
 
+	std::cout << std::endl;
+	std::cout << "Mersen prime number test with Lucas-Lehmer: " << std::endl;
+	MersenTest<BigInt>( 24, true, true );
+
 	// Probability test
 	std::cout << "Probability of non-prime ouput with non-prime input. Random selection for only one time." << std::endl;
 	StatisticProbTest(100000);
@@ -0,0 +1,29 @@
+/*************************************************************************
+*
+* Header file Stopwatch.h
+*	elapsed time on the monotonic clock for the timings of the tests
+*	and the benchmarks
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef STOPWATCH_H
+#define STOPWATCH_H
+
+#include <chrono>
+
+// Elapsed time on the monotonic clock ( not moved by clock adjustments )
+struct Stopwatch {
+	std::chrono::steady_clock::time_point start;
+
+	Stopwatch():start( std::chrono::steady_clock::now() ) {};
+	// started only when run is true ( debug timing off the hot path )
+	explicit Stopwatch( bool run ) { if ( run ) Reset(); };
+
+	void Reset() { start = std::chrono::steady_clock::now(); };
+	double Ns() const { return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count(); };
+	double Ms() const { return Ns() / 1e6; };
+};
+
+#endif
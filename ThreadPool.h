@@ -0,0 +1,112 @@
+/*************************************************************************
+*
+* Header file ThreadPool.h
+*	fixed pool of worker threads for the parallel prime tests
+*	jobs hand out indices from an atomic cursor so that fast threads
+*	take over the remaining work of slow ones
+*
+* Written by myself - Tran Quoc Hoan - The University of Tokyo
+*
+*************************************************************************/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+#include "Limb.h"
+
+struct ThreadPool {
+	std::vector<std::thread> workers;
+	std::deque< std::function<void()> > tasks;
+	std::mutex mtx;
+	std::condition_variable wake;	// signals new tasks or stop
+	std::condition_variable idle;	// signals that all tasks are finished
+	SizeType pending;		// submitted and not finished tasks
+	bool stop;
+
+	ThreadPool( int nthreads = 0 );
+	~ThreadPool();
+
+	int Size() const { return (int)workers.size(); };
+	void Submit( const std::function<void()> &task );
+	void Wait();
+	void ParallelFor( DatType count, const std::function<void( DatType )> &body );
+
+	void Worker();
+};
+
+// Number of hardware threads, at least one
+static inline int HardwareThreads() {
+	int n = (int)std::thread::hardware_concurrency();
+	return ( n > 0 )?n:1;
+}
+
+inline ThreadPool::ThreadPool( int nthreads ):pending(0),stop(false) {
+	if ( nthreads <= 0 ) nthreads = HardwareThreads();
+	for ( int i = 0; i < nthreads; i++ )
+		workers.push_back( std::thread( &ThreadPool::Worker, this ) );
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		stop = true;
+	}
+	wake.notify_all();
+	for ( size_t i = 0; i < workers.size(); i++ ) workers[i].join();
+}
+
+inline void ThreadPool::Worker() {
+	while ( true ) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock( mtx );
+			while ( !stop && tasks.empty() ) wake.wait( lock );
+			if ( tasks.empty() ) return;
+			task = tasks.front();
+			tasks.pop_front();
+		}
+		task();
+		std::lock_guard<std::mutex> lock( mtx );
+		if ( --pending == 0 ) idle.notify_all();
+	}
+}
+
+inline void ThreadPool::Submit( const std::function<void()> &task ) {
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		tasks.push_back( task );
+		pending++;
+	}
+	wake.notify_one();
+}
+
+// Block until every submitted task has finished
+// ( must not be called from a task of the same pool )
+inline void ThreadPool::Wait() {
+	std::unique_lock<std::mutex> lock( mtx );
+	while ( pending > 0 ) idle.wait( lock );
+}
+
+// Run body( i ) for 0 <= i < count on all workers and wait
+// Each worker pulls the next index from a shared cursor until none is left
+inline void ThreadPool::ParallelFor( DatType count, const std::function<void( DatType )> &body ) {
+	std::atomic<DatType> cursor( 0 );
+	int nt = ( count < Size() )?(int)count:Size();
+	for ( int t = 0; t < nt; t++ ) {
+		Submit( [&cursor, count, &body]() {
+			DatType i;
+			while ( ( i = cursor.fetch_add( 1 ) ) < count ) body( i );
+		} );
+	}
+	Wait();
+}
+
+#endif